@@ -0,0 +1,279 @@
+/***********************************************************************************************************************
+*                                                                                                                      *
+* embedded-utils                                                                                                       *
+*                                                                                                                      *
+* Copyright (c) 2020-2025 Andrew D. Zonenberg                                                                          *
+* All rights reserved.                                                                                                 *
+*                                                                                                                      *
+* Redistribution and use in source and binary forms, with or without modification, are permitted provided that the     *
+* following conditions are met:                                                                                        *
+*                                                                                                                      *
+*    * Redistributions of source code must retain the above copyright notice, this list of conditions, and the         *
+*      following disclaimer.                                                                                           *
+*                                                                                                                      *
+*    * Redistributions in binary form must reproduce the above copyright notice, this list of conditions and the       *
+*      following disclaimer in the documentation and/or other materials provided with the distribution.                *
+*                                                                                                                      *
+*    * Neither the name of the author nor the names of any contributors may be used to endorse or promote products     *
+*      derived from this software without specific prior written permission.                                           *
+*                                                                                                                      *
+* THIS SOFTWARE IS PROVIDED BY THE AUTHORS "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED   *
+* TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL *
+* THE AUTHORS BE HELD LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES        *
+* (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR       *
+* BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT *
+* (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE       *
+* POSSIBILITY OF SUCH DAMAGE.                                                                                          *
+*                                                                                                                      *
+***********************************************************************************************************************/
+
+#ifndef BinaryLogger_h
+#define BinaryLogger_h
+
+#include <stdint.h>
+#include <string.h>
+#include <type_traits>
+
+#include "Logger.h"
+#include "MonotonicClock.h"
+
+#ifdef HAVE_TIM
+
+/**
+	@file
+	@brief Deferred binary logging, with formatting done on the host by tools/binlog_decode.py
+
+	Each BINLOG() call site puts its format string in the .logstr section, and only the address of the string goes
+	into the log. The section is never loaded, so the strings cost no flash. Add it to the linker script as
+
+		.logstr 0 (INFO) : { KEEP(*(.logstr)) }
+
+	so string addresses are offsets from zero and the decoder can find them in the ELF.
+
+	Record format, in 32-bit little endian words:
+		header		0xb1 in bits 31:24, LogType in bits 23:16, total length in words (including header) in bits 15:0
+		id			Address of the format string in .logstr
+		timestamp	Two words, low word first: 64-bit MonotonicClock tick count, the same timebase as Logger and Tracer
+		args...		One word per argument of 32 bits or less, two (low word first) for 64-bit integers and doubles.
+					Strings are a byte count word followed by the bytes, zero padded to a whole word.
+
+	A record with id DROPPED_ID (0xffffffff, which can't be a .logstr address) reports dropped records, and has one
+	argument with the number dropped since the last one. It's placed in the stream where the gap is.
+ */
+
+///@brief Logs a message in binary form. Arguments must match the format string just as with printf.
+#define BINLOG(log, type, fmt, ...) \
+	do \
+	{ \
+		__attribute__((section(".logstr"))) static const char binlog_fmt_[] = fmt; \
+		(log).Log(type, reinterpret_cast<uintptr_t>(binlog_fmt_), ##__VA_ARGS__); \
+	} while(0)
+
+/**
+	@brief Records log messages as format string IDs plus raw argument words in a ring buffer
+
+	Logging from interrupts is safe: each record is written inside a critical section, so it is never torn. If there
+	isn't room for a whole record, it's dropped and counted rather than blocking.
+
+	@tparam DEPTH	Ring size in 32-bit words, must be a power of two
+ */
+template<uint32_t DEPTH>
+class BinaryLogger
+{
+public:
+	static_assert( (DEPTH & (DEPTH - 1)) == 0, "BinaryLogger depth must be a power of two");
+
+	BinaryLogger()
+	: m_clock(nullptr)
+	, m_wptr(0)
+	, m_rptr(0)
+	, m_dropped(0)
+	{}
+
+	/**
+		@brief Initializes the logger
+
+		@param clock	Timebase to take timestamps from, normally the logger's (Logger::GetClock()) so binary records
+						line up with text log messages and trace events
+	 */
+	void Initialize(MonotonicClock* clock)
+	{ m_clock = clock; }
+
+	static const uint32_t RECORD_MAGIC = 0xb1;
+	static const uint32_t HEADER_WORDS = 4;
+	static const uint32_t DROPPED_ID = 0xffffffff;
+	static const uint32_t DROPPED_WORDS = HEADER_WORDS + 1;
+
+	///@brief Appends a record to the ring. Normally called through BINLOG() rather than directly.
+	template<class... Args>
+	void Log(Logger::LogType type, uint32_t id, Args... args)
+	{
+		uint32_t len = HEADER_WORDS + (0 + ... + ArgWords(args));
+
+		#if !defined(SIMULATION) && !defined(SOFTCORE_NO_IRQ)
+			uint32_t sr = EnterCriticalSection();
+		#endif
+
+		//If anything was dropped, the drop report goes in ahead of the first record that fits
+		uint32_t needed = len + (m_dropped ? DROPPED_WORDS : 0);
+		if( (m_wptr - m_rptr + needed) > DEPTH)
+			m_dropped = m_dropped + 1;
+
+		else
+		{
+			if(m_dropped)
+			{
+				PutDropRecord(m_dropped);
+				m_dropped = 0;
+			}
+
+			PutWord( (RECORD_MAGIC << 24) | (type << 16) | len);
+			PutWord(id);
+			PutTimestamp();
+			(PutArg(args), ...);
+		}
+
+		#if !defined(SIMULATION) && !defined(SOFTCORE_NO_IRQ)
+			LeaveCriticalSection(sr);
+		#endif
+	}
+
+	/**
+		@brief Sends everything in the ring to a device in raw binary form
+
+		Call from the idle loop, not from an interrupt.
+	 */
+	void Drain(CharacterDevice* target)
+	{
+		//Writers only ever move m_wptr forward, so a snapshot of it is safe to drain up to.
+		//Take it together with the drop count: drops not yet in the ring happened after everything before the snapshot.
+		#if !defined(SIMULATION) && !defined(SOFTCORE_NO_IRQ)
+			uint32_t sr = EnterCriticalSection();
+		#endif
+
+		uint32_t wptr = m_wptr;
+		uint32_t dropped = m_dropped;
+		m_dropped = 0;
+
+		#if !defined(SIMULATION) && !defined(SOFTCORE_NO_IRQ)
+			LeaveCriticalSection(sr);
+		#endif
+
+		while(m_rptr != wptr)
+		{
+			//Send up to the end of the buffer in one go
+			uint32_t start = m_rptr & (DEPTH - 1);
+			uint32_t count = wptr - m_rptr;
+			if(start + count > DEPTH)
+				count = DEPTH - start;
+
+			target->Write(reinterpret_cast<const char*>(const_cast<uint32_t*>(&m_ring[start])), count * 4);
+			m_rptr += count;
+		}
+
+		//Then report the drops, after the records that were buffered before them
+		if(dropped)
+		{
+			uint64_t now = GetTimestamp();
+			uint32_t rec[DROPPED_WORDS] =
+			{
+				(RECORD_MAGIC << 24) | (Logger::WARNING << 16) | DROPPED_WORDS,
+				DROPPED_ID,
+				static_cast<uint32_t>(now),
+				static_cast<uint32_t>(now >> 32),
+				dropped
+			};
+			target->Write(reinterpret_cast<const char*>(rec), sizeof(rec));
+		}
+	}
+
+	///@brief Number of records dropped since the last Drain()
+	uint32_t GetDroppedCount()
+	{ return m_dropped; }
+
+protected:
+
+	//Argument sizing and encoding
+	template<class T>
+	static uint32_t ArgWords(T arg)
+	{
+		if constexpr(std::is_same_v<T, const char*> || std::is_same_v<T, char*>)
+			return 1 + (strlen(arg) + 3) / 4;
+		else if constexpr(std::is_floating_point_v<T> || (sizeof(T) == 8) )
+			return 2;
+		else
+			return 1;
+	}
+
+	template<class T>
+	void PutArg(T arg)
+	{
+		if constexpr(std::is_same_v<T, const char*> || std::is_same_v<T, char*>)
+		{
+			uint32_t len = strlen(arg);
+			PutWord(len);
+			for(uint32_t i=0; i<len; i += 4)
+			{
+				uint32_t w = 0;
+				memcpy(&w, arg + i, (len - i) < 4 ? (len - i) : 4);
+				PutWord(w);
+			}
+		}
+		else if constexpr(std::is_floating_point_v<T>)
+		{
+			double d = arg;
+			uint64_t bits;
+			memcpy(&bits, &d, sizeof(bits));
+			PutWord(bits);
+			PutWord(bits >> 32);
+		}
+		else if constexpr(sizeof(T) == 8)
+		{
+			uint64_t v = static_cast<uint64_t>(arg);
+			PutWord(v);
+			PutWord(v >> 32);
+		}
+		else if constexpr(std::is_pointer_v<T>)
+			PutWord(reinterpret_cast<uintptr_t>(arg));
+		else
+			PutWord(static_cast<uint32_t>(arg));
+	}
+
+	void PutDropRecord(uint32_t dropped)
+	{
+		PutWord( (RECORD_MAGIC << 24) | (Logger::WARNING << 16) | DROPPED_WORDS);
+		PutWord(DROPPED_ID);
+		PutTimestamp();
+		PutWord(dropped);
+	}
+
+	uint64_t GetTimestamp()
+	{ return m_clock ? m_clock->GetTicks() : 0; }
+
+	void PutTimestamp()
+	{
+		uint64_t now = GetTimestamp();
+		PutWord(now);
+		PutWord(now >> 32);
+	}
+
+	void PutWord(uint32_t w)
+	{
+		m_ring[m_wptr & (DEPTH - 1)] = w;
+		m_wptr = m_wptr + 1;
+	}
+
+	MonotonicClock* m_clock;
+
+	volatile uint32_t m_ring[DEPTH];
+
+	//Free-running word counts, only masked when indexing the ring
+	volatile uint32_t m_wptr;
+	volatile uint32_t m_rptr;
+
+	volatile uint32_t m_dropped;
+};
+
+#endif
+
+#endif
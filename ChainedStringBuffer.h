@@ -0,0 +1,267 @@
+/***********************************************************************************************************************
+*                                                                                                                      *
+* embedded-utils                                                                                                       *
+*                                                                                                                      *
+* Copyright (c) 2020-2025 Andrew D. Zonenberg                                                                          *
+* All rights reserved.                                                                                                 *
+*                                                                                                                      *
+* Redistribution and use in source and binary forms, with or without modification, are permitted provided that the     *
+* following conditions are met:                                                                                        *
+*                                                                                                                      *
+*    * Redistributions of source code must retain the above copyright notice, this list of conditions, and the         *
+*      following disclaimer.                                                                                           *
+*                                                                                                                      *
+*    * Redistributions in binary form must reproduce the above copyright notice, this list of conditions and the       *
+*      following disclaimer in the documentation and/or other materials provided with the distribution.                *
+*                                                                                                                      *
+*    * Neither the name of the author nor the names of any contributors may be used to endorse or promote products     *
+*      derived from this software without specific prior written permission.                                           *
+*                                                                                                                      *
+* THIS SOFTWARE IS PROVIDED BY THE AUTHORS "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED   *
+* TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL *
+* THE AUTHORS BE HELD LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES        *
+* (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR       *
+* BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT *
+* (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE       *
+* POSSIBILITY OF SUCH DAMAGE.                                                                                          *
+*                                                                                                                      *
+***********************************************************************************************************************/
+
+#ifndef ChainedStringBuffer_h
+#define ChainedStringBuffer_h
+
+#include <stdint.h>
+#include <string.h>
+
+#include "CharacterDevice.h"
+
+/**
+	@brief One fixed-size block of a ChainedStringBuffer
+ */
+template<size_t BLOCKSIZE>
+class StringBlock
+{
+public:
+	StringBlock* m_next;
+	uint32_t m_used;
+	char m_data[BLOCKSIZE];
+};
+
+/**
+	@brief A free list of StringBlock's carved out of caller-provided storage
+
+	Must only be used from application code - NOT interrupt safe.
+ */
+template<size_t BLOCKSIZE>
+class StringBlockPool
+{
+public:
+	StringBlockPool(StringBlock<BLOCKSIZE>* blocks, uint32_t count)
+	: m_free(nullptr)
+	, m_freeCount(0)
+	{
+		for(uint32_t i=0; i<count; i++)
+			Free(&blocks[i]);
+	}
+
+	//Copies would hand out the same blocks twice
+	StringBlockPool(const StringBlockPool&) = delete;
+	StringBlockPool& operator=(const StringBlockPool&) = delete;
+
+	///@brief Gets a block from the pool, or nullptr if none are left
+	StringBlock<BLOCKSIZE>* Allocate()
+	{
+		auto block = m_free;
+		if(block)
+		{
+			m_free = block->m_next;
+			m_freeCount --;
+
+			block->m_next = nullptr;
+			block->m_used = 0;
+		}
+		return block;
+	}
+
+	///@brief Returns a block to the pool
+	void Free(StringBlock<BLOCKSIZE>* block)
+	{
+		block->m_next = m_free;
+		m_free = block;
+		m_freeCount ++;
+	}
+
+	///@brief Number of blocks currently available
+	uint32_t GetFreeCount()
+	{ return m_freeCount; }
+
+protected:
+	StringBlock<BLOCKSIZE>* m_free;
+	uint32_t m_freeCount;
+};
+
+/**
+	@brief A StringBlockPool with its own statically allocated storage
+ */
+template<size_t BLOCKSIZE, uint32_t NBLOCKS>
+class StaticStringBlockPool : public StringBlockPool<BLOCKSIZE>
+{
+public:
+	StaticStringBlockPool()
+	: StringBlockPool<BLOCKSIZE>(m_storage, NBLOCKS)
+	{}
+
+protected:
+	StringBlock<BLOCKSIZE> m_storage[NBLOCKS];
+};
+
+/**
+	@brief One contiguous piece of a ChainedStringBuffer, for handing to a DMA engine or other scatter-gather consumer
+ */
+struct StringScatterEntry
+{
+	const char* m_data;
+	uint32_t m_len;
+};
+
+/**
+	@brief String builder that grows in fixed-size blocks drawn from a shared pool
+
+	Unlike StringBuffer, the output is not contiguous and is never null terminated. Read it back with WriteTo(),
+	GetScatterList(), or by walking the blocks from GetFirstBlock().
+
+	If the pool runs dry, further output is discarded but still counted, the same as a full StringBuffer.
+ */
+template<size_t BLOCKSIZE>
+class ChainedStringBuffer : public CharacterDevice
+{
+public:
+	ChainedStringBuffer(StringBlockPool<BLOCKSIZE>& pool)
+	: m_pool(pool)
+	, m_head(nullptr)
+	, m_tail(nullptr)
+	, m_len(0)
+	, m_wanted(0)
+	{}
+
+	virtual ~ChainedStringBuffer()
+	{ Clear(); }
+
+	//Owns its blocks, so a copy would return them to the pool twice
+	ChainedStringBuffer(const ChainedStringBuffer&) = delete;
+	ChainedStringBuffer& operator=(const ChainedStringBuffer&) = delete;
+
+	virtual void PrintBinary(char ch) override
+	{ Write(&ch, 1); }
+
+	virtual void Write(const char* data, uint32_t len) override
+	{
+		m_wanted += len;
+		while(len)
+		{
+			//Grab a new block if the current one is full
+			if(!m_tail || (m_tail->m_used == BLOCKSIZE) )
+			{
+				auto block = m_pool.Allocate();
+				if(!block)
+					return;
+
+				if(m_tail)
+					m_tail->m_next = block;
+				else
+					m_head = block;
+				m_tail = block;
+			}
+
+			uint32_t space = BLOCKSIZE - m_tail->m_used;
+			uint32_t n = (len < space) ? len : space;
+			memcpy(m_tail->m_data + m_tail->m_used, data, n);
+			m_tail->m_used += n;
+			m_len += n;
+			data += n;
+			len -= n;
+		}
+	}
+
+	virtual void PrintString(const char* str) override
+	{ PrintStringByRuns(str); }
+
+	///@brief not used, but has to be defined because base class needs it
+	virtual char BlockingRead() override
+	{ return 0; }
+
+	///@brief Streams the contents to another device, one Write() call per block
+	void WriteTo(CharacterDevice* target)
+	{
+		for(auto block = m_head; block; block = block->m_next)
+			target->Write(block->m_data, block->m_used);
+	}
+
+	/**
+		@brief Fills out a scatter list covering the contents, without copying anything
+
+		@param list		Array to fill
+		@param maxlen	Size of the array
+
+		@return Number of entries filled in (check against GetBlockCount() to see if it was big enough)
+	 */
+	uint32_t GetScatterList(StringScatterEntry* list, uint32_t maxlen)
+	{
+		uint32_t n = 0;
+		for(auto block = m_head; block && (n < maxlen); block = block->m_next, n++)
+		{
+			list[n].m_data = block->m_data;
+			list[n].m_len = block->m_used;
+		}
+		return n;
+	}
+
+	const StringBlock<BLOCKSIZE>* GetFirstBlock()
+	{ return m_head; }
+
+	uint32_t GetBlockCount()
+	{
+		uint32_t n = 0;
+		for(auto block = m_head; block; block = block->m_next)
+			n ++;
+		return n;
+	}
+
+	///@brief Number of characters actually stored
+	size_t length()
+	{ return m_len; }
+
+	///@brief Number of characters that were written, including any that didn't fit
+	size_t WantedLength()
+	{ return m_wanted; }
+
+	///@brief True if anything was discarded because the pool ran out of blocks
+	bool Overflowed()
+	{ return m_wanted > m_len; }
+
+	///@brief Returns all blocks to the pool and resets to an empty state
+	void Clear()
+	{
+		auto block = m_head;
+		while(block)
+		{
+			auto next = block->m_next;
+			m_pool.Free(block);
+			block = next;
+		}
+
+		m_head = nullptr;
+		m_tail = nullptr;
+		m_len = 0;
+		m_wanted = 0;
+	}
+
+protected:
+	StringBlockPool<BLOCKSIZE>& m_pool;
+	StringBlock<BLOCKSIZE>* m_head;
+	StringBlock<BLOCKSIZE>* m_tail;
+	size_t m_len;
+	size_t m_wanted;
+};
+
+#endif
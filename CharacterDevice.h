@@ -98,7 +98,12 @@ public:
 			data[i] = BlockingRead();
 	}
 
-	void Write(const char* data, uint32_t len)
+	/**
+		@brief Writes a block of raw bytes with no newline translation
+
+		Derived classes with a faster path than one PrintBinary() call per byte should override this.
+	 */
+	virtual void Write(const char* data, uint32_t len)
 	{
 		for(uint32_t i=0; i<len; i++)
 			PrintBinary(data[i]);
@@ -112,6 +117,34 @@ public:
 
 	virtual void Flush()
 	{}
+
+protected:
+
+	/**
+		@brief PrintString() implementation for devices with a fast Write()
+
+		Sends each run of text between newlines with a single Write() call, and only goes through PrintText() for the
+		newlines themselves.
+	 */
+	void PrintStringByRuns(const char* str)
+	{
+		size_t len = FastStrlen(str);
+		while(len)
+		{
+			auto nl = FastMemchr(str, '\n', len);
+			if(!nl)
+			{
+				Write(str, len);
+				break;
+			}
+
+			size_t run = nl - str;
+			Write(str, run);
+			PrintText('\n');
+			str += run + 1;
+			len -= run + 1;
+		}
+	}
 };
 
 #endif
@@ -0,0 +1,72 @@
+/***********************************************************************************************************************
+*                                                                                                                      *
+* embedded-utils                                                                                                       *
+*                                                                                                                      *
+* Copyright (c) 2020-2025 Andrew D. Zonenberg                                                                          *
+* All rights reserved.                                                                                                 *
+*                                                                                                                      *
+* Redistribution and use in source and binary forms, with or without modification, are permitted provided that the     *
+* following conditions are met:                                                                                        *
+*                                                                                                                      *
+*    * Redistributions of source code must retain the above copyright notice, this list of conditions, and the         *
+*      following disclaimer.                                                                                           *
+*                                                                                                                      *
+*    * Redistributions in binary form must reproduce the above copyright notice, this list of conditions and the       *
+*      following disclaimer in the documentation and/or other materials provided with the distribution.                *
+*                                                                                                                      *
+*    * Neither the name of the author nor the names of any contributors may be used to endorse or promote products     *
+*      derived from this software without specific prior written permission.                                           *
+*                                                                                                                      *
+* THIS SOFTWARE IS PROVIDED BY THE AUTHORS "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED   *
+* TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL *
+* THE AUTHORS BE HELD LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES        *
+* (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR       *
+* BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT *
+* (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE       *
+* POSSIBILITY OF SUCH DAMAGE.                                                                                          *
+*                                                                                                                      *
+***********************************************************************************************************************/
+
+#include "Cobs.h"
+
+/**
+	@brief Encodes a frame so it contains no zero bytes
+
+	The delimiter is not added, so several pieces can be sent before it if needed.
+
+	@param in	Frame to encode
+	@param len	Length of the frame
+	@param out	Buffer for the encoded frame, at least COBS_MAX_ENCODED_SIZE(len) bytes. Must not overlap in.
+
+	@return Encoded length
+ */
+uint32_t CobsEncode(const uint8_t* in, uint32_t len, uint8_t* out)
+{
+	//Each block is a code byte, one more than the number of nonzero bytes which follow it. A code of 0xff means 254
+	//bytes with no implied zero after them.
+	uint32_t code = 0;
+	uint32_t wptr = 1;
+	uint8_t run = 1;
+	for(uint32_t i=0; i<len; i++)
+	{
+		if(in[i] == 0)
+		{
+			out[code] = run;
+			code = wptr ++;
+			run = 1;
+			continue;
+		}
+
+		out[wptr ++] = in[i];
+		run ++;
+		if(run == 0xff)
+		{
+			out[code] = run;
+			code = wptr ++;
+			run = 1;
+		}
+	}
+
+	out[code] = run;
+	return wptr;
+}
@@ -27,9 +27,83 @@
 *                                                                                                                      *
 ***********************************************************************************************************************/
 
-#include <embedded-utils/Logger.h>
-#include <embedded-utils/CoreSightRom.h>
 #include <stdint.h>
+#include <embedded-utils/CoreSightRom.h>
+
+//Only needed for printing, which is only available where there's a Logger (HAVE_TIM)
+#include <embedded-utils/Logger.h>
+
+//All Cortex-M7's start here (?)
+static uint32_t* const g_ppbRomBase = reinterpret_cast<uint32_t*>(0xe00f'e000);
+
+//Nesting limit for ROM tables, in case of a loop
+static const int g_maxRomDepth = 4;
+
+/**
+	@brief Reads the component ID of a CoreSight component
+ */
+static uint32_t GetComponentID(uint32_t* p)
+{
+	return
+		(p[1023] << 24) |
+		(p[1022] << 16) |
+		(p[1021] << 8) |
+		p[1020];
+}
+
+/**
+	@brief Checks the preamble bits of a component ID (ADIv5 13.2)
+ */
+static bool IsValidComponentID(uint32_t cid)
+{
+	return (cid & 0xffff0fff) == 0xb105000d;
+}
+
+/**
+	@brief Checks if the ROM tables list a valid component at a given address, e.g. to confirm a DWT is present
+
+	Only the component ID registers of each entry are read, so this is safe to use before touching the component.
+ */
+bool FindRomComponent(uintptr_t address)
+{
+	return FindRomComponent(g_ppbRomBase, address);
+}
+
+/**
+	@brief Checks if a component, or anything in it if it's a ROM table, is a valid component at a given address
+ */
+bool FindRomComponent(uint32_t* p, uintptr_t address, int depth)
+{
+	uint32_t cid = GetComponentID(p);
+	if(!IsValidComponentID(cid))
+		return false;
+	if(reinterpret_cast<uintptr_t>(p) == address)
+		return true;
+
+	//Only ROM tables have anything below them
+	if( ( (cid >> 12) & 0xf) != 1)
+		return false;
+	if(depth >= g_maxRomDepth)
+		return false;
+
+	for(int i=0; i<960; i++)
+	{
+		uint32_t entry = p[i];
+		if(entry == 0)
+			break;
+
+		//Skip non-present entries and 8-bit tables
+		if( (entry & 3) != 3)
+			continue;
+
+		if(FindRomComponent(p + ( (entry & 0xfffff000) >> 2), address, depth + 1))
+			return true;
+	}
+
+	return false;
+}
+
+#ifdef HAVE_TIM
 
 extern Logger g_log;
 
@@ -38,9 +112,7 @@ void PrintRomTables()
 	g_log("Printing CoreSight ROM tables\n");
 	LogIndenter li(g_log);
 
-	//All Cortex-M7's start here (?)
-	uint32_t* ppbRomBase = reinterpret_cast<uint32_t*>(0xe00f'e000);
-	PrintComponent(ppbRomBase);
+	PrintComponent(g_ppbRomBase);
 }
 
 void PrintComponent(uint32_t* p)
@@ -61,11 +133,7 @@ void PrintComponent(uint32_t* p)
 		(p[1017] << 8) |
 		p[1016];
 
-	uint32_t cid =
-		(p[1023] << 24) |
-		(p[1022] << 16) |
-		(p[1021] << 8) |
-		p[1020];
+	uint32_t cid = GetComponentID(p);
 
 	g_log("PID = %08x %08x\n", pid[1], pid[0]);
 	g_log("CID = %08x\n", cid);
@@ -168,3 +236,5 @@ void PrintRomTable(uint32_t* p)
 		}
 	}
 }
+
+#endif
@@ -30,11 +30,17 @@
 #ifndef CoreSightRom_h
 #define CoreSightRom_h
 
-//Main entry point
+#include <stdint.h>
+
+//Main entry point. Printing is only available where there's a Logger (HAVE_TIM).
 void PrintRomTables();
 
 //Helpers for each type
 void PrintComponent(uint32_t* p);
 void PrintRomTable(uint32_t* p);
 
+//Checks if a component is listed, without printing anything
+bool FindRomComponent(uintptr_t address);
+bool FindRomComponent(uint32_t* p, uintptr_t address, int depth = 0);
+
 #endif
@@ -0,0 +1,264 @@
+/***********************************************************************************************************************
+*                                                                                                                      *
+* embedded-utils                                                                                                       *
+*                                                                                                                      *
+* Copyright (c) 2020-2025 Andrew D. Zonenberg                                                                          *
+* All rights reserved.                                                                                                 *
+*                                                                                                                      *
+* Redistribution and use in source and binary forms, with or without modification, are permitted provided that the     *
+* following conditions are met:                                                                                        *
+*                                                                                                                      *
+*    * Redistributions of source code must retain the above copyright notice, this list of conditions, and the         *
+*      following disclaimer.                                                                                           *
+*                                                                                                                      *
+*    * Redistributions in binary form must reproduce the above copyright notice, this list of conditions and the       *
+*      following disclaimer in the documentation and/or other materials provided with the distribution.                *
+*                                                                                                                      *
+*    * Neither the name of the author nor the names of any contributors may be used to endorse or promote products     *
+*      derived from this software without specific prior written permission.                                           *
+*                                                                                                                      *
+* THIS SOFTWARE IS PROVIDED BY THE AUTHORS "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED   *
+* TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL *
+* THE AUTHORS BE HELD LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES        *
+* (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR       *
+* BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT *
+* (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE       *
+* POSSIBILITY OF SUCH DAMAGE.                                                                                          *
+*                                                                                                                      *
+***********************************************************************************************************************/
+
+#ifndef CrashLog_h
+#define CrashLog_h
+
+#include <stdint.h>
+#include <string.h>
+#include "CharacterDevice.h"
+
+/**
+	@brief Backing store for a CrashLog
+
+	This has to live in RAM which isn't cleared or initialized at startup, so declare it with no initializer in a
+	NOLOAD section, e.g.
+
+		__attribute__((section(".noinit"))) CrashLogBuffer<4096> g_crashLogBuffer;
+
+	On parts with a data cache, put it in TCM or non-cacheable RAM, or the last lines may still be in the cache when
+	the reset hits.
+
+	@tparam SIZE	Ring size in bytes, must be a power of two
+ */
+template<uint32_t SIZE>
+struct CrashLogBuffer
+{
+	static_assert( (SIZE & (SIZE - 1)) == 0, "CrashLogBuffer size must be a power of two");
+
+	///@brief Fixed header, covered by m_headerCrc
+	uint32_t m_magic;
+	uint32_t m_size;
+	uint32_t m_address;
+	uint32_t m_headerCrc;
+
+	///@brief Write pointer, in [0, 2*SIZE) so a full ring can be told apart from an empty one, and its complement
+	volatile uint32_t m_wptr;
+	volatile uint32_t m_wptrCheck;
+
+	char m_data[SIZE];
+};
+
+/**
+	@brief A character device which keeps the most recent output in a ring buffer that survives a warm reset
+
+	Typically teed with the UART as the Logger target (see TeeCharacterDevice), then dumped at the next boot to see
+	what led up to a hard fault or watchdog reset. Writes are a memcpy plus two pointer stores, so it's cheap enough to
+	leave enabled permanently.
+
+	The header (magic, size and buffer address) is checked with a CRC, so a cold boot or a firmware update which moves
+	the buffer is detected. Per-write cost rules out a CRC over the data, so the write pointer is instead stored along
+	with its complement. Data is always written before the pointer, so a reset between the two pointer stores is
+	recognized and the pointer which was written first is trusted, as long as the complement still holds a plausible
+	previous value. Anything else starts a new log.
+ */
+template<uint32_t SIZE>
+class CrashLog : public CharacterDevice
+{
+public:
+	static const uint32_t MAGIC = 0x434c4f47;	//"CLOG"
+
+	/**
+		@brief Creates the device. The buffer isn't touched until Initialize() is called.
+	 */
+	CrashLog(CrashLogBuffer<SIZE>& buf)
+	: m_buf(buf)
+	{}
+
+	/**
+		@brief Checks if the buffer holds a log from before the reset, and starts a new one if not
+
+		Recovered contents are kept, and new output is appended to them.
+
+		@return True if a log was recovered
+	 */
+	bool Initialize()
+	{
+		if(IsValid())
+		{
+			//Finish a pointer update cut short by the reset
+			SetWritePointer(m_buf.m_wptr);
+			return true;
+		}
+
+		Clear();
+		return false;
+	}
+
+	///@brief Discards the contents of the log
+	void Clear()
+	{
+		m_buf.m_magic = MAGIC;
+		m_buf.m_size = SIZE;
+		m_buf.m_address = Address();
+		m_buf.m_headerCrc = HeaderCRC();
+		SetWritePointer(0);
+	}
+
+	///@brief Number of bytes in the log
+	uint32_t length()
+	{
+		uint32_t wptr = m_buf.m_wptr;
+		return (wptr > SIZE) ? SIZE : wptr;
+	}
+
+	/**
+		@brief Sends the contents of the log, oldest first, to a device
+
+		If the ring has wrapped, the partial line at the start is skipped.
+	 */
+	void Dump(CharacterDevice* target)
+	{
+		uint32_t wptr = m_buf.m_wptr;
+		if(wptr <= SIZE)
+		{
+			target->Write(m_buf.m_data, wptr);
+			return;
+		}
+
+		uint32_t start = wptr & (SIZE - 1);
+		const char* tail = m_buf.m_data + start;
+		uint32_t taillen = SIZE - start;
+		auto nl = static_cast<const char*>(memchr(tail, '\n', taillen));
+		if(nl)
+		{
+			target->Write(nl + 1, taillen - (nl + 1 - tail));
+			target->Write(m_buf.m_data, start);
+		}
+		else
+		{
+			nl = static_cast<const char*>(memchr(m_buf.m_data, '\n', start));
+			if(nl)
+				target->Write(nl + 1, start - (nl + 1 - m_buf.m_data));
+		}
+	}
+
+	virtual void PrintBinary(char ch) override
+	{
+		uint32_t wptr = m_buf.m_wptr;
+		m_buf.m_data[wptr & (SIZE - 1)] = ch;
+		SetWritePointer(wptr + 1);
+	}
+
+	virtual void Write(const char* data, uint32_t len) override
+	{
+		//Only the last SIZE bytes can be kept anyway
+		uint32_t wptr = m_buf.m_wptr;
+		if(len > SIZE)
+		{
+			data += len - SIZE;
+			wptr += len - SIZE;
+			len = SIZE;
+		}
+
+		uint32_t start = wptr & (SIZE - 1);
+		uint32_t first = SIZE - start;
+		if(first > len)
+			first = len;
+		memcpy(m_buf.m_data + start, data, first);
+		memcpy(m_buf.m_data, data + first, len - first);
+
+		SetWritePointer(wptr + len);
+	}
+
+	///@brief not used, but has to be defined because base class needs it
+	virtual char BlockingRead() override
+	{ return 0; }
+
+protected:
+
+	/**
+		@brief Checks the header and write pointer left in the buffer
+	 */
+	bool IsValid()
+	{
+		if( (m_buf.m_magic != MAGIC) || (m_buf.m_size != SIZE) )
+			return false;
+		if(m_buf.m_address != Address())
+			return false;
+		if(m_buf.m_headerCrc != HeaderCRC())
+			return false;
+
+		uint32_t wptr = m_buf.m_wptr;
+		uint32_t prev = ~m_buf.m_wptrCheck;
+		if( (wptr >= 2*SIZE) || (prev >= 2*SIZE) )
+			return false;
+		if(wptr == prev)
+			return true;
+
+		//The pointer is stored before its complement. If the reset came between the two, the complement still holds
+		//the previous pointer, which has to be no more than one ring's worth of writing behind the new one.
+		if(prev < wptr)
+			return (wptr - prev) <= SIZE;
+
+		//A new pointer behind the previous one is only possible if it was folded back into [SIZE, 2*SIZE)
+		return (prev >= SIZE) && (wptr >= SIZE);
+	}
+
+	uint32_t Address()
+	{ return static_cast<uint32_t>(reinterpret_cast<uintptr_t>(&m_buf)); }
+
+	/**
+		@brief Stores a new write pointer, after the data has been written
+
+		Wraps the pointer back into [SIZE, 2*SIZE) once the ring is full.
+	 */
+	void SetWritePointer(uint32_t wptr)
+	{
+		if(wptr >= 2*SIZE)
+			wptr = SIZE + (wptr & (SIZE - 1));
+
+		asm volatile("" ::: "memory");
+		m_buf.m_wptr = wptr;
+		m_buf.m_wptrCheck = ~wptr;
+	}
+
+	/**
+		@brief CRC-32 (IEEE 802.3) of the fixed header fields
+	 */
+	uint32_t HeaderCRC()
+	{
+		uint32_t words[3] = { m_buf.m_magic, m_buf.m_size, m_buf.m_address };
+		auto p = reinterpret_cast<const uint8_t*>(words);
+
+		uint32_t crc = 0xffffffff;
+		for(uint32_t i=0; i<sizeof(words); i++)
+		{
+			crc ^= p[i];
+			for(int j=0; j<8; j++)
+				crc = (crc >> 1) ^ (0xedb88320 & -(crc & 1));
+		}
+		return ~crc;
+	}
+
+protected:
+	CrashLogBuffer<SIZE>& m_buf;
+};
+
+#endif
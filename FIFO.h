@@ -129,6 +129,80 @@ public:
 		return ret;
 	}
 
+	/**
+		@brief Adds a block of items to the FIFO in a single critical section.
+
+		Either all of the items are pushed, or none of them are.
+
+		@return True if pushed, false if there wasn't enough space
+	 */
+	bool PushBlock(const objtype* items, uint32_t count)
+	{
+		#if !defined(SIMULATION) && !defined(SOFTCORE_NO_IRQ)
+			uint32_t sr = EnterCriticalSection();
+		#endif
+
+		uint32_t used = InternalSize();
+		if( (count == 0) || (count > (depth - used)) )
+		{
+			#if !defined(SIMULATION) && !defined(SOFTCORE_NO_IRQ)
+				LeaveCriticalSection(sr);
+			#endif
+			return count == 0;
+		}
+
+		uint32_t wptr = m_wptr;
+		for(uint32_t i=0; i<count; i++)
+		{
+			m_storage[wptr] = items[i];
+			wptr ++;
+			if(wptr == depth)
+				wptr = 0;
+		}
+		m_wptr = wptr;
+		m_empty = false;
+
+		#if !defined(SIMULATION) && !defined(SOFTCORE_NO_IRQ)
+			LeaveCriticalSection(sr);
+		#endif
+
+		return true;
+	}
+
+	/**
+		@brief Removes up to maxcount items from the FIFO in a single critical section.
+
+		@return Number of items actually removed
+	 */
+	uint32_t PopBlock(objtype* items, uint32_t maxcount)
+	{
+		#if !defined(SIMULATION) && !defined(SOFTCORE_NO_IRQ)
+			uint32_t sr = EnterCriticalSection();
+		#endif
+
+		uint32_t count = InternalSize();
+		if(count > maxcount)
+			count = maxcount;
+
+		uint32_t rptr = m_rptr;
+		for(uint32_t i=0; i<count; i++)
+		{
+			items[i] = *const_cast<objtype*>(&m_storage[rptr]);
+			rptr ++;
+			if(rptr == depth)
+				rptr = 0;
+		}
+		m_rptr = rptr;
+		if(count && (rptr == m_wptr) )
+			m_empty = true;
+
+		#if !defined(SIMULATION) && !defined(SOFTCORE_NO_IRQ)
+			LeaveCriticalSection(sr);
+		#endif
+
+		return count;
+	}
+
 	/**
 		@brief Returns the number of elements in the FIFO
 	 */
@@ -138,13 +212,7 @@ public:
 			uint32_t sr = EnterCriticalSection();
 		#endif
 
-		uint32_t size = 0;
-		if(IsEmpty())
-			size = 0;
-		else if(IsFull())
-			size = depth;
-		else
-			size = (m_wptr - m_rptr) % depth;
+		uint32_t size = InternalSize();
 
 		#if !defined(SIMULATION) && !defined(SOFTCORE_NO_IRQ)
 			LeaveCriticalSection(sr);
@@ -197,6 +265,19 @@ public:
 
 protected:
 
+	/**
+		@brief Returns the number of elements in the FIFO without any interlocks.
+	 */
+	uint32_t InternalSize()
+	{
+		if(m_empty)
+			return 0;
+		else if(m_wptr == m_rptr)
+			return depth;
+		else
+			return (m_wptr + depth - m_rptr) % depth;
+	}
+
 	/**
 		@brief Checks if the FIFO is full without any interlocks.
 	 */
@@ -0,0 +1,298 @@
+/***********************************************************************************************************************
+*                                                                                                                      *
+* embedded-utils                                                                                                       *
+*                                                                                                                      *
+* Copyright (c) 2020-2024 Andrew D. Zonenberg                                                                          *
+* All rights reserved.                                                                                                 *
+*                                                                                                                      *
+* Redistribution and use in source and binary forms, with or without modification, are permitted provided that the     *
+* following conditions are met:                                                                                        *
+*                                                                                                                      *
+*    * Redistributions of source code must retain the above copyright notice, this list of conditions, and the         *
+*      following disclaimer.                                                                                           *
+*                                                                                                                      *
+*    * Redistributions in binary form must reproduce the above copyright notice, this list of conditions and the       *
+*      following disclaimer in the documentation and/or other materials provided with the distribution.                *
+*                                                                                                                      *
+*    * Neither the name of the author nor the names of any contributors may be used to endorse or promote products     *
+*      derived from this software without specific prior written permission.                                           *
+*                                                                                                                      *
+* THIS SOFTWARE IS PROVIDED BY THE AUTHORS "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED   *
+* TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL *
+* THE AUTHORS BE HELD LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES        *
+* (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR       *
+* BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT *
+* (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE       *
+* POSSIBILITY OF SUCH DAMAGE.                                                                                          *
+*                                                                                                                      *
+***********************************************************************************************************************/
+
+#ifndef FixedPoint_h
+#define FixedPoint_h
+
+#include <stdint.h>
+
+/**
+	@file
+	@brief Fixed point value types for use on cores without an FPU
+
+	All types are plain integer wrappers and can be printed with the nonstandard %k printf extension by passing the raw
+	value (see DoPrintf).
+ */
+
+/**
+	@brief Next wider integer type, used for intermediate products of 8.8 and 16.16 values
+ */
+template<class T> struct FixedPointWide;
+template<> struct FixedPointWide<int16_t>	{ typedef int32_t type; };
+template<> struct FixedPointWide<uint16_t>	{ typedef uint32_t type; };
+template<> struct FixedPointWide<int32_t>	{ typedef int64_t type; };
+template<> struct FixedPointWide<uint32_t>	{ typedef uint64_t type; };
+
+/**
+	@brief Multiply and divide kernels for formats that fit in a native wide type
+ */
+template<class T, int FRAC>
+struct FixedPointOps
+{
+	typedef typename FixedPointWide<T>::type W;
+
+	static T Mul(T a, T b)
+	{ return static_cast<T>( (static_cast<W>(a) * b) >> FRAC); }
+
+	static T Div(T a, T b)
+	{ return static_cast<T>( (static_cast<W>(a) * (W(1) << FRAC)) / b); }
+};
+
+/**
+	@brief Computes bits 32-95 of the unsigned 128-bit product of a and b, using only 32x32 multiplies
+ */
+inline uint64_t FixedMulU64Shift32(uint64_t a, uint64_t b)
+{
+	uint32_t al = a;
+	uint32_t ah = a >> 32;
+	uint32_t bl = b;
+	uint32_t bh = b >> 32;
+
+	uint64_t lo = static_cast<uint64_t>(al) * bl;
+	uint64_t mid = static_cast<uint64_t>(ah) * bl + static_cast<uint64_t>(al) * bh;
+	uint64_t hi = static_cast<uint64_t>(ah * bh);
+
+	return (hi << 32) + mid + (lo >> 32);
+}
+
+/**
+	@brief Computes (a << 32) / b for unsigned 64-bit values without a 128-bit divide
+ */
+inline uint64_t FixedDivU64Shift32(uint64_t a, uint64_t b)
+{
+	//Divide the top 64 bits natively, then shift the 32 low zero bits in one at a time
+	uint64_t q = a / b;
+	uint64_t r = a % b;
+	for(int i=0; i<32; i++)
+	{
+		bool carry = (r >> 63) != 0;
+		r <<= 1;
+		q <<= 1;
+		if(carry || (r >= b) )
+		{
+			r -= b;
+			q |= 1;
+		}
+	}
+	return q;
+}
+
+/**
+	@brief 32.32 kernels, since there's no wider native type for the intermediate result
+ */
+template<>
+struct FixedPointOps<uint64_t, 32>
+{
+	static uint64_t Mul(uint64_t a, uint64_t b)
+	{ return FixedMulU64Shift32(a, b); }
+
+	static uint64_t Div(uint64_t a, uint64_t b)
+	{ return FixedDivU64Shift32(a, b); }
+};
+
+template<>
+struct FixedPointOps<int64_t, 32>
+{
+	static int64_t Mul(int64_t a, int64_t b)
+	{
+		//Unsigned product, then correct the high half for the two's complement inputs.
+		//This rounds toward negative infinity, same as the arithmetic shift used for the narrower formats.
+		uint64_t r = FixedMulU64Shift32(a, b);
+		if(a < 0)
+			r -= static_cast<uint64_t>(b) << 32;
+		if(b < 0)
+			r -= static_cast<uint64_t>(a) << 32;
+		return static_cast<int64_t>(r);
+	}
+
+	static int64_t Div(int64_t a, int64_t b)
+	{
+		//Divide magnitudes, rounding toward zero like the native integer divide
+		uint64_t ua = (a < 0) ? -static_cast<uint64_t>(a) : a;
+		uint64_t ub = (b < 0) ? -static_cast<uint64_t>(b) : b;
+		uint64_t q = FixedDivU64Shift32(ua, ub);
+		if( (a < 0) != (b < 0) )
+			q = -q;
+		return static_cast<int64_t>(q);
+	}
+};
+
+/**
+	@brief A fixed point number with FRAC fractional bits stored in an integer of type T
+
+	Multiplication truncates toward negative infinity, division toward zero. Overflow wraps like the underlying integer.
+	Division by zero is undefined, as with integers.
+ */
+template<class T, int FRAC>
+class FixedPoint
+{
+public:
+	typedef T raw_t;
+	static const int FRAC_BITS = FRAC;
+
+	constexpr FixedPoint()
+	: m_raw(0)
+	{}
+
+	///@brief Creates a value from its raw integer representation
+	static constexpr FixedPoint FromRaw(T raw)
+	{
+		FixedPoint ret;
+		ret.m_raw = raw;
+		return ret;
+	}
+
+	///@brief Creates a value from an integer
+	static constexpr FixedPoint FromInt(T n)
+	{ return FromRaw(n * ONE); }
+
+	/**
+		@brief Creates a value from a floating point constant
+
+		Intended for compile time constants only. Calling at run time will pull in soft-float on FPU-less cores.
+	 */
+	static constexpr FixedPoint FromDouble(double d)
+	{ return FromRaw(static_cast<T>(d * ONE + (d < 0 ? -0.5 : 0.5))); }
+
+	///@brief Creates a value from the ratio num / den
+	static FixedPoint FromRatio(T num, T den)
+	{ return FromRaw(FixedPointOps<T, FRAC>::Div(num, den)); }
+
+	///@brief Gets the raw integer representation, as expected by %k in printf
+	constexpr T Raw() const
+	{ return m_raw; }
+
+	///@brief Integer part, rounded toward negative infinity
+	constexpr T Floor() const
+	{ return m_raw >> FRAC; }
+
+	///@brief Integer part, rounded to nearest (ties upward). Adds the half bit after shifting, so it can't overflow.
+	constexpr T Round() const
+	{ return (m_raw >> FRAC) + ( (m_raw >> (FRAC - 1)) & 1); }
+
+	///@brief Fractional bits only
+	constexpr T FracBits() const
+	{ return m_raw & (ONE - 1); }
+
+	/**
+		@brief Converts to a different fixed point format
+
+		Fractional bits are truncated when narrowing. Integer bits that don't fit in the new format are lost.
+	 */
+	template<class T2, int FRAC2>
+	FixedPoint<T2, FRAC2> Convert() const
+	{
+		if constexpr(FRAC2 >= FRAC)
+			return FixedPoint<T2, FRAC2>::FromRaw(static_cast<T2>(m_raw) * (T2(1) << (FRAC2 - FRAC)) );
+		else
+			return FixedPoint<T2, FRAC2>::FromRaw(static_cast<T2>(m_raw >> (FRAC - FRAC2)) );
+	}
+
+	//Arithmetic
+	FixedPoint operator+(FixedPoint rhs) const
+	{ return FromRaw(m_raw + rhs.m_raw); }
+
+	FixedPoint operator-(FixedPoint rhs) const
+	{ return FromRaw(m_raw - rhs.m_raw); }
+
+	FixedPoint operator-() const
+	{ return FromRaw(-m_raw); }
+
+	FixedPoint operator*(FixedPoint rhs) const
+	{ return FromRaw(FixedPointOps<T, FRAC>::Mul(m_raw, rhs.m_raw)); }
+
+	FixedPoint operator/(FixedPoint rhs) const
+	{ return FromRaw(FixedPointOps<T, FRAC>::Div(m_raw, rhs.m_raw)); }
+
+	///@brief Multiplies by an integer (cheaper than a fixed point multiply, no rounding)
+	FixedPoint operator*(T rhs) const
+	{ return FromRaw(m_raw * rhs); }
+
+	///@brief Divides by an integer (cheaper than a fixed point divide)
+	FixedPoint operator/(T rhs) const
+	{ return FromRaw(m_raw / rhs); }
+
+	FixedPoint& operator+=(FixedPoint rhs)
+	{
+		m_raw += rhs.m_raw;
+		return *this;
+	}
+
+	FixedPoint& operator-=(FixedPoint rhs)
+	{
+		m_raw -= rhs.m_raw;
+		return *this;
+	}
+
+	FixedPoint& operator*=(FixedPoint rhs)
+	{
+		m_raw = FixedPointOps<T, FRAC>::Mul(m_raw, rhs.m_raw);
+		return *this;
+	}
+
+	FixedPoint& operator/=(FixedPoint rhs)
+	{
+		m_raw = FixedPointOps<T, FRAC>::Div(m_raw, rhs.m_raw);
+		return *this;
+	}
+
+	//Comparisons
+	bool operator==(FixedPoint rhs) const
+	{ return m_raw == rhs.m_raw; }
+
+	bool operator!=(FixedPoint rhs) const
+	{ return m_raw != rhs.m_raw; }
+
+	bool operator<(FixedPoint rhs) const
+	{ return m_raw < rhs.m_raw; }
+
+	bool operator<=(FixedPoint rhs) const
+	{ return m_raw <= rhs.m_raw; }
+
+	bool operator>(FixedPoint rhs) const
+	{ return m_raw > rhs.m_raw; }
+
+	bool operator>=(FixedPoint rhs) const
+	{ return m_raw >= rhs.m_raw; }
+
+protected:
+	static constexpr T ONE = T(1) << FRAC;
+
+	T m_raw;
+};
+
+//Standard formats, matching the printf conversions %hk, %uhk, %k, %uk, %lk, %ulk
+typedef FixedPoint<int16_t, 8>		fix8_8_t;
+typedef FixedPoint<uint16_t, 8>		ufix8_8_t;
+typedef FixedPoint<int32_t, 16>		fix16_16_t;
+typedef FixedPoint<uint32_t, 16>	ufix16_16_t;
+typedef FixedPoint<int64_t, 32>		fix32_32_t;
+typedef FixedPoint<uint64_t, 32>	ufix32_32_t;
+
+#endif
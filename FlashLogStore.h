@@ -0,0 +1,489 @@
+/***********************************************************************************************************************
+*                                                                                                                      *
+* embedded-utils                                                                                                       *
+*                                                                                                                      *
+* Copyright (c) 2020-2025 Andrew D. Zonenberg                                                                          *
+* All rights reserved.                                                                                                 *
+*                                                                                                                      *
+* Redistribution and use in source and binary forms, with or without modification, are permitted provided that the     *
+* following conditions are met:                                                                                        *
+*                                                                                                                      *
+*    * Redistributions of source code must retain the above copyright notice, this list of conditions, and the         *
+*      following disclaimer.                                                                                           *
+*                                                                                                                      *
+*    * Redistributions in binary form must reproduce the above copyright notice, this list of conditions and the       *
+*      following disclaimer in the documentation and/or other materials provided with the distribution.                *
+*                                                                                                                      *
+*    * Neither the name of the author nor the names of any contributors may be used to endorse or promote products     *
+*      derived from this software without specific prior written permission.                                           *
+*                                                                                                                      *
+* THIS SOFTWARE IS PROVIDED BY THE AUTHORS "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED   *
+* TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL *
+* THE AUTHORS BE HELD LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES        *
+* (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR       *
+* BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT *
+* (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE       *
+* POSSIBILITY OF SUCH DAMAGE.                                                                                          *
+*                                                                                                                      *
+***********************************************************************************************************************/
+
+#ifndef FlashLogStore_h
+#define FlashLogStore_h
+
+#include <stdint.h>
+#include <string.h>
+#include "CharacterDevice.h"
+
+/**
+	@brief A character device which appends log output to a circular region of SPI flash, surviving power loss
+
+	Output is collected in a page buffer in RAM, and only whole pages are programmed, so there is exactly one page
+	program per page of log. Each page starts with a small header, followed by the data:
+		seq		32-bit page sequence number, counting every page ever written. Always equal to the page's index within
+				the region modulo the number of pages, and never 0xffffffff, so erased pages are easy to spot.
+		len		16-bit number of data bytes in the page (less than a full page after a Flush())
+		crc		CRC-16/CCITT over seq, len and the data
+
+	The sector after the one being written is always kept erased, by erasing it as the write head enters a sector. At
+	boot the head is found by binary search on the page sequence numbers, reading one header per step. Pages which fail
+	the CRC, such as one being programmed when power was lost, are skipped by the reader.
+
+	A page which fails to program is counted and skipped, and its data is tried once more in the next page. The skipped
+	page is given a header with no data, so sequence numbers stay in order for the search. Nothing is logged about it,
+	since this is usually the logger's own target. Output arriving while a page is being programmed
+	(e.g. from the flash driver itself) is dropped and counted.
+
+	Erasing a sector blocks for as long as the flash takes, so pick a region where that's acceptable for whatever
+	calls the logger when the head crosses a sector boundary.
+
+	FLASH is any driver with these methods. Only APB_SpiFlashInterface is supported for now, since
+	QuadSPI_SpiFlashInterface::Write() programs in 32-byte chunks rather than whole pages.
+		void ReadData(uint32_t addr, uint8_t* data, uint32_t len);
+		bool WriteData(uint32_t addr, const uint8_t* data, uint32_t len);	//one page, never crossing a page boundary
+		bool EraseSector(uint32_t addr);
+		uint32_t GetSectorSize();
+		uint32_t GetMaxWriteBlockSize();
+
+	@tparam FLASH		Flash driver type
+	@tparam PAGE_SIZE	Flash page size in bytes, must divide the sector size
+ */
+template<class FLASH, uint32_t PAGE_SIZE = 256>
+class FlashLogStore : public CharacterDevice
+{
+public:
+	static const uint32_t HEADER_SIZE = 8;
+	static const uint32_t DATA_SIZE = PAGE_SIZE - HEADER_SIZE;
+	static const uint32_t ERASED = 0xffffffff;
+
+	static_assert(PAGE_SIZE > HEADER_SIZE, "FlashLogStore page too small");
+
+	FlashLogStore(FLASH& flash)
+	: m_flash(flash)
+	, m_base(0)
+	, m_pageCount(0)
+	, m_pagesPerSector(1)
+	, m_nextSeq(0)
+	, m_len(0)
+	, m_busy(false)
+	, m_failedPages(0)
+	, m_failedErases(0)
+	, m_droppedBytes(0)
+	{}
+
+	/**
+		@brief Finds the write head in an existing log, or sets up an empty one
+
+		@param base		Flash address of the region, which must be sector aligned
+		@param size		Size of the region in bytes, a multiple of the sector size and at least two sectors
+
+		@return False if the region isn't usable, in which case all output is dropped
+	 */
+	bool Initialize(uint32_t base, uint32_t size)
+	{
+		m_pageCount = 0;
+		m_len = 0;
+
+		uint32_t sectorSize = m_flash.GetSectorSize();
+		if( (sectorSize == 0) || (PAGE_SIZE > m_flash.GetMaxWriteBlockSize()) )
+			return false;
+		if( (sectorSize % PAGE_SIZE) || (base % sectorSize) || (size % sectorSize) || (size < 2*sectorSize) )
+			return false;
+
+		m_base = base;
+		m_pagesPerSector = sectorSize / PAGE_SIZE;
+		m_pageCount = size / PAGE_SIZE;
+
+		//Carry on from the page after the newest one, in the same lap
+		int64_t newest = FindNewest();
+		m_nextSeq = 0;
+		if(newest >= 0)
+		{
+			m_nextSeq = (GetSeq(newest) / m_pageCount) * m_pageCount + newest;
+			AdvanceSeq();
+		}
+
+		//Skip anything left in the sector by a page which was being programmed when power was lost, along with any
+		//failed pages before it
+		uint32_t next = m_nextSeq % m_pageCount;
+		if( (next % m_pagesPerSector) != 0)
+		{
+			for(uint32_t skip = CountUsedPages(next); skip; skip--)
+			{
+				MarkSkipped(m_nextSeq % m_pageCount, m_nextSeq);
+				AdvanceSeq();
+			}
+			next = m_nextSeq % m_pageCount;
+		}
+
+		//The next sector should be erased already, unless power was lost during the erase or while programming the
+		//first pages in it
+		if( ( (next % m_pagesPerSector) == 0) && CountUsedPages(next) )
+			EraseSectorOf(next);
+
+		return true;
+	}
+
+	virtual void PrintBinary(char ch) override
+	{
+		if(m_busy)
+		{
+			m_droppedBytes ++;
+			return;
+		}
+
+		m_page[HEADER_SIZE + (m_len++)] = ch;
+		if(m_len == DATA_SIZE)
+			ProgramPage();
+	}
+
+	virtual void Write(const char* data, uint32_t len) override
+	{
+		if(m_busy)
+		{
+			m_droppedBytes += len;
+			return;
+		}
+
+		while(len)
+		{
+			uint32_t n = DATA_SIZE - m_len;
+			if(n > len)
+				n = len;
+			memcpy(m_page + HEADER_SIZE + m_len, data, n);
+			m_len += n;
+			data += n;
+			len -= n;
+
+			if(m_len == DATA_SIZE)
+				ProgramPage();
+		}
+	}
+
+	virtual void PrintString(const char* str) override
+	{ PrintStringByRuns(str); }
+
+	/**
+		@brief Programs the partial page in RAM right away, e.g. before a reset. This costs a whole page of flash.
+	 */
+	virtual void Flush() override
+	{
+		if(m_len && !m_busy)
+			ProgramPage();
+	}
+
+	///@brief Number of pages which failed to program, and were skipped
+	uint32_t GetFailedPages()
+	{ return m_failedPages; }
+
+	///@brief Number of sector erases which failed
+	uint32_t GetFailedErases()
+	{ return m_failedErases; }
+
+	///@brief Number of bytes of output lost, to re-entrant calls, unusable flash, or pages failing twice
+	uint32_t GetDroppedBytes()
+	{ return m_droppedBytes; }
+
+	///@brief unimplemented but the base class doesn't know that
+	virtual char BlockingRead() override
+	{ return 0; }
+
+	/**
+		@brief Sends the whole log to a device, oldest first, including anything not programmed yet
+
+		One flash read and one Write() per page.
+	 */
+	void Dump(CharacterDevice* target)
+	{
+		//The sector after the newest page's is erased, so the oldest page is the first of the one after that
+		int64_t end = m_nextSeq;
+		int64_t start = 0;
+		if(end)
+		{
+			int64_t last = end - 1;
+			start = last - (last % m_pagesPerSector) + 2*m_pagesPerSector - m_pageCount;
+			if(start < 0)
+				start = 0;
+		}
+
+		uint8_t page[PAGE_SIZE];
+		for(int64_t seq = start; (seq < end) && m_pageCount; seq++)
+		{
+			uint32_t len = ReadPage(seq % m_pageCount, page);
+			if(len)
+				target->Write(reinterpret_cast<const char*>(page + HEADER_SIZE), len);
+		}
+
+		if(m_len)
+			target->Write(reinterpret_cast<const char*>(m_page + HEADER_SIZE), m_len);
+	}
+
+protected:
+
+	///@brief Flash address of a page within the region
+	uint32_t PageAddress(uint32_t page)
+	{ return m_base + page * PAGE_SIZE; }
+
+	///@brief Reads the sequence number of a page, ERASED if it's blank
+	uint32_t GetSeq(uint32_t page)
+	{
+		uint32_t seq;
+		m_flash.ReadData(PageAddress(page), reinterpret_cast<uint8_t*>(&seq), sizeof(seq));
+		return seq;
+	}
+
+	/**
+		@brief Checks that a page header belongs to its position in the region, i.e. isn't blank or torn
+
+		The header is programmed in order, so if the length is still blank the sequence number may be incomplete.
+
+		@param lap	Lap of the region the page must have been written in, or ERASED for any
+	 */
+	bool IsPageInLap(uint32_t page, uint32_t lap)
+	{
+		uint8_t header[6];
+		m_flash.ReadData(PageAddress(page), header, sizeof(header));
+		uint32_t seq;
+		uint16_t len;
+		memcpy(&seq, header, 4);
+		memcpy(&len, header + 4, 2);
+		if( (seq == ERASED) || (len > DATA_SIZE) || ( (seq % m_pageCount) != page) )
+			return false;
+		return (lap == ERASED) || ( (seq / m_pageCount) == lap);
+	}
+
+	/**
+		@brief Counts the pages from one to the last in its sector which isn't blank, or zero if they all are
+	 */
+	uint32_t CountUsedPages(uint32_t start)
+	{
+		uint32_t end = start - (start % m_pagesPerSector) + m_pagesPerSector;
+		uint32_t count = 0;
+		for(uint32_t page = start; page < end; page++)
+		{
+			if(GetSeq(page) != ERASED)
+				count = page + 1 - start;
+		}
+		return count;
+	}
+
+	/**
+		@brief Finds the first intact page in a sector
+
+		@return Page index, or -1 if there's none
+	 */
+	int64_t FindFirstInSector(uint32_t start)
+	{
+		for(uint32_t page = start; page < start + m_pagesPerSector; page++)
+		{
+			if(IsPageInLap(page, ERASED))
+				return page;
+		}
+		return -1;
+	}
+
+	/**
+		@brief Finds the newest page with an intact header, or -1 if there is none
+
+		Pages 0 to the head hold the current lap of the region, and anything after the erased gap the previous one. If
+		sector 0 has no intact page it's in the gap (perhaps along with a page torn as power was lost), and every sector
+		after it was written in the same lap, so the search starts from the first intact page of those.
+
+		Pages which failed to program are given a header anyway (see MarkSkipped()), but if that failed too they leave
+		a hole, which may even be blank. A hole can only make the binary search stop early, so it's followed by a walk
+		forward until a whole sector has nothing from the current lap, i.e. the erased one after the head's. That costs
+		up to two sectors' worth of header reads.
+	 */
+	int64_t FindNewest()
+	{
+		int64_t first = -1;
+		for(uint32_t start = 0; (first < 0) && (start < m_pageCount); start += m_pagesPerSector)
+			first = FindFirstInSector(start);
+		if(first < 0)
+			return -1;
+
+		//Last page in [lo, hi] written in the same lap as page lo
+		uint32_t lo = first;
+		uint32_t hi = m_pageCount - 1;
+		uint32_t lap = GetSeq(lo) / m_pageCount;
+		while(lo < hi)
+		{
+			uint32_t mid = lo + (hi - lo + 1) / 2;
+			if(IsPageInLap(mid, lap))
+				lo = mid;
+			else
+				hi = mid - 1;
+		}
+
+		//Everything from there to the gap is the current lap, holes included
+		uint32_t end = (lo / m_pagesPerSector + 2) * m_pagesPerSector;
+		for(uint32_t page = lo + 1; (page < end) && (page < m_pageCount); page++)
+		{
+			if(IsPageInLap(page, lap))
+			{
+				lo = page;
+				end = (lo / m_pagesPerSector + 2) * m_pagesPerSector;
+			}
+		}
+		return lo;
+	}
+
+	/**
+		@brief Reads a page, checking it
+
+		@return Number of data bytes, or zero if the page is blank or damaged
+	 */
+	uint32_t ReadPage(uint32_t index, uint8_t* page)
+	{
+		m_flash.ReadData(PageAddress(index), page, PAGE_SIZE);
+
+		uint32_t seq;
+		uint16_t len;
+		uint16_t crc;
+		memcpy(&seq, page, 4);
+		memcpy(&len, page + 4, 2);
+		memcpy(&crc, page + 6, 2);
+		if( (seq == ERASED) || ( (seq % m_pageCount) != index) || (len > DATA_SIZE) )
+			return 0;
+		if(crc != CRC(page, len))
+			return 0;
+		return len;
+	}
+
+	/**
+		@brief Programs the page buffer, trying the next page if that fails
+
+		Output from anything called from here (such as the flash driver logging an error) is dropped, since the page
+		buffer is in use.
+	 */
+	void ProgramPage()
+	{
+		m_busy = true;
+
+		if( (m_pageCount == 0) || (!ProgramPageAt(m_nextSeq) && !ProgramPageAt(m_nextSeq) ) )
+			m_droppedBytes += m_len;
+		m_len = 0;
+
+		m_busy = false;
+	}
+
+	/**
+		@brief Fills in the header of the page buffer and programs it, erasing the following sector first if needed
+
+		The page is used up either way, so the sequence number always advances. A page which fails is marked as
+		skipped, so the sequence numbers the boot time search relies on stay in order.
+
+		@return True on success
+	 */
+	bool ProgramPageAt(uint32_t seq)
+	{
+		uint32_t index = seq % m_pageCount;
+		if( (index % m_pagesPerSector) == 0)
+			EraseSectorOf( (index + m_pagesPerSector) % m_pageCount);
+
+		//Pad the rest of the page with 0xff so it isn't programmed
+		uint16_t len = m_len;
+		memset(m_page + HEADER_SIZE + m_len, 0xff, DATA_SIZE - m_len);
+		memcpy(m_page, &seq, 4);
+		memcpy(m_page + 4, &len, 2);
+		uint16_t crc = CRC(m_page, len);
+		memcpy(m_page + 6, &crc, 2);
+
+		AdvanceSeq();
+
+		if(!m_flash.WriteData(PageAddress(index), m_page, PAGE_SIZE))
+		{
+			m_failedPages ++;
+			MarkSkipped(index, seq);
+			return false;
+		}
+		return true;
+	}
+
+	/**
+		@brief Programs a header with no data over a page which failed to program or was torn
+
+		Programming can only clear bits, and anything already programmed in the sequence number came from the same
+		value, so this leaves a valid sequence number. The length and CRC are cleared to zero, and readers skip the
+		page since it has no data.
+	 */
+	void MarkSkipped(uint32_t index, uint32_t seq)
+	{
+		uint8_t header[HEADER_SIZE];
+		memcpy(header, &seq, 4);
+		memset(header + 4, 0, HEADER_SIZE - 4);
+		m_flash.WriteData(PageAddress(index), header, HEADER_SIZE);
+	}
+
+	///@brief Moves on to the next page. Sequence numbers must stay a multiple of the page count apart from ERASED.
+	void AdvanceSeq()
+	{
+		m_nextSeq ++;
+		if(m_nextSeq == ERASED - (ERASED % m_pageCount) )
+			m_nextSeq = 0;
+	}
+
+	void EraseSectorOf(uint32_t page)
+	{
+		if(!m_flash.EraseSector(PageAddress(page - (page % m_pagesPerSector) ) ) )
+			m_failedErases ++;
+	}
+
+	///@brief CRC-16/CCITT over the sequence number, length and data of a page
+	static uint16_t CRC(const uint8_t* page, uint32_t len)
+	{
+		uint16_t crc = 0xffff;
+		for(uint32_t i=0; i<HEADER_SIZE + len; i++)
+		{
+			//Skip the CRC itself
+			if( (i == 6) || (i == 7) )
+				continue;
+
+			crc ^= page[i] << 8;
+			for(int j=0; j<8; j++)
+				crc = (crc & 0x8000) ? ( (crc << 1) ^ 0x1021) : (crc << 1);
+		}
+		return crc;
+	}
+
+	FLASH& m_flash;
+
+	uint32_t m_base;
+	uint32_t m_pageCount;
+	uint32_t m_pagesPerSector;
+
+	///@brief Sequence number of the page being filled
+	uint32_t m_nextSeq;
+
+	///@brief Page being filled, and the number of data bytes in it
+	uint8_t m_page[PAGE_SIZE];
+	uint32_t m_len;
+
+	///@brief Set while a page is being programmed
+	bool m_busy;
+
+	uint32_t m_failedPages;
+	uint32_t m_failedErases;
+	uint32_t m_droppedBytes;
+};
+
+#endif
@@ -0,0 +1,168 @@
+/***********************************************************************************************************************
+*                                                                                                                      *
+* embedded-utils                                                                                                       *
+*                                                                                                                      *
+* Copyright (c) 2020-2025 Andrew D. Zonenberg                                                                          *
+* All rights reserved.                                                                                                 *
+*                                                                                                                      *
+* Redistribution and use in source and binary forms, with or without modification, are permitted provided that the     *
+* following conditions are met:                                                                                        *
+*                                                                                                                      *
+*    * Redistributions of source code must retain the above copyright notice, this list of conditions, and the         *
+*      following disclaimer.                                                                                           *
+*                                                                                                                      *
+*    * Redistributions in binary form must reproduce the above copyright notice, this list of conditions and the       *
+*      following disclaimer in the documentation and/or other materials provided with the distribution.                *
+*                                                                                                                      *
+*    * Neither the name of the author nor the names of any contributors may be used to endorse or promote products     *
+*      derived from this software without specific prior written permission.                                           *
+*                                                                                                                      *
+* THIS SOFTWARE IS PROVIDED BY THE AUTHORS "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED   *
+* TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL *
+* THE AUTHORS BE HELD LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES        *
+* (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR       *
+* BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT *
+* (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE       *
+* POSSIBILITY OF SUCH DAMAGE.                                                                                          *
+*                                                                                                                      *
+***********************************************************************************************************************/
+
+#ifndef LogIsrRing_h
+#define LogIsrRing_h
+
+#include <stdint.h>
+
+#if !defined(SIMULATION) && !defined(SOFTCORE_NO_IRQ)
+#include <stm32.h>
+#endif
+
+/**
+	@brief Ring of lines logged from interrupts, for thread level code to send out later
+
+	An interrupt claims a slot, formats its line into it with interrupts enabled, and commits it by setting its length
+	last. Only claiming is interlocked, and that's a handful of instructions, so a higher priority interrupt can claim
+	the following slot meanwhile. The reader takes lines in the order the slots were claimed, stopping at one which is
+	claimed but not finished yet. If the ring is full, lines are dropped and counted.
+
+	@tparam DEPTH		Number of slots
+	@tparam MAX_LINE	Longest line in bytes
+ */
+template<uint32_t DEPTH, uint32_t MAX_LINE>
+class LogIsrRing
+{
+public:
+
+	///@brief One line. Zero length means free, or claimed but not finished yet.
+	struct Slot
+	{
+		volatile uint32_t m_len;
+		uint8_t m_type;
+		uint8_t m_module;
+		char m_text[MAX_LINE];
+	};
+
+	LogIsrRing()
+	: m_wptr(0)
+	, m_rptr(0)
+	, m_dropped(0)
+	{
+		for(uint32_t i=0; i<DEPTH; i++)
+			m_slots[i].m_len = 0;
+	}
+
+	/**
+		@brief Claims the next slot for a line, from any interrupt priority
+
+		@return The slot, or null if the ring is full and the line has been counted as dropped
+	 */
+	Slot* Claim(uint8_t type, uint8_t module)
+	{
+		#if !defined(SIMULATION) && !defined(SOFTCORE_NO_IRQ)
+			uint32_t sr = EnterCriticalSection();
+		#endif
+
+		uint32_t wptr = m_wptr;
+		bool full = (wptr - m_rptr) >= DEPTH;
+		if(full)
+			m_dropped = m_dropped + 1;
+		else
+			m_wptr = wptr + 1;
+
+		#if !defined(SIMULATION) && !defined(SOFTCORE_NO_IRQ)
+			LeaveCriticalSection(sr);
+		#endif
+
+		if(full)
+			return nullptr;
+
+		auto& slot = m_slots[wptr % DEPTH];
+		slot.m_type = type;
+		slot.m_module = module;
+		return &slot;
+	}
+
+	///@brief Hands a claimed slot over to the reader once its text is complete
+	void Commit(Slot* slot, uint32_t len)
+	{
+		asm volatile("" ::: "memory");
+		slot->m_len = len;
+	}
+
+	///@brief Checks if there's anything for the reader, lines or a count of dropped ones
+	bool IsPending()
+	{ return (m_rptr != m_wptr) || m_dropped; }
+
+	/**
+		@brief Gets the oldest line, from thread level only
+
+		@return The slot, or null if the ring is empty or the oldest slot isn't finished yet
+	 */
+	Slot* Peek()
+	{
+		if(m_rptr == m_wptr)
+			return nullptr;
+
+		auto& slot = m_slots[m_rptr % DEPTH];
+		if(!slot.m_len)
+			return nullptr;
+		asm volatile("" ::: "memory");
+		return &slot;
+	}
+
+	///@brief Frees the slot returned by Peek()
+	void Pop()
+	{
+		m_slots[m_rptr % DEPTH].m_len = 0;
+		m_rptr = m_rptr + 1;
+	}
+
+	///@brief Gets and clears the number of lines dropped
+	uint32_t TakeDropped()
+	{
+		if(!m_dropped)
+			return 0;
+
+		#if !defined(SIMULATION) && !defined(SOFTCORE_NO_IRQ)
+			uint32_t sr = EnterCriticalSection();
+		#endif
+
+		uint32_t dropped = m_dropped;
+		m_dropped = 0;
+
+		#if !defined(SIMULATION) && !defined(SOFTCORE_NO_IRQ)
+			LeaveCriticalSection(sr);
+		#endif
+
+		return dropped;
+	}
+
+protected:
+	Slot m_slots[DEPTH];
+
+	///@brief Free running slot indexes: next to claim, next to drain
+	volatile uint32_t m_wptr;
+	volatile uint32_t m_rptr;
+	volatile uint32_t m_dropped;
+};
+
+#endif
@@ -0,0 +1,214 @@
+/***********************************************************************************************************************
+*                                                                                                                      *
+* embedded-utils                                                                                                       *
+*                                                                                                                      *
+* Copyright (c) 2020-2025 Andrew D. Zonenberg                                                                          *
+* All rights reserved.                                                                                                 *
+*                                                                                                                      *
+* Redistribution and use in source and binary forms, with or without modification, are permitted provided that the     *
+* following conditions are met:                                                                                        *
+*                                                                                                                      *
+*    * Redistributions of source code must retain the above copyright notice, this list of conditions, and the         *
+*      following disclaimer.                                                                                           *
+*                                                                                                                      *
+*    * Redistributions in binary form must reproduce the above copyright notice, this list of conditions and the       *
+*      following disclaimer in the documentation and/or other materials provided with the distribution.                *
+*                                                                                                                      *
+*    * Neither the name of the author nor the names of any contributors may be used to endorse or promote products     *
+*      derived from this software without specific prior written permission.                                           *
+*                                                                                                                      *
+* THIS SOFTWARE IS PROVIDED BY THE AUTHORS "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED   *
+* TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL *
+* THE AUTHORS BE HELD LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES        *
+* (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR       *
+* BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT *
+* (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE       *
+* POSSIBILITY OF SUCH DAMAGE.                                                                                          *
+*                                                                                                                      *
+***********************************************************************************************************************/
+
+#ifndef LogRateLimiter_h
+#define LogRateLimiter_h
+
+#include <stdint.h>
+
+/**
+	@brief Protects a log from message storms, deciding per call site without formatting anything
+
+	Call sites are identified by their format string pointer. Both limits are off until enabled:
+	  * Consecutive messages from the same call site within the repeat window of the last one admitted are counted
+		rather than admitted, to be summarized as "last message repeated N times". Arguments are not compared, so a
+		loop printing a table from one call site is collapsed too; only enable this where that's acceptable.
+	  * Each call site has a token bucket, hashed into a table of SLOTS entries. Messages beyond the burst size are
+		suppressed until tokens refill, and the number suppressed is reported with the next message from that site
+		which gets through. Call sites which hash to a busy slot share its bucket.
+
+	Times are in ticks of whatever clock the caller uses.
+
+	@tparam SLOTS	Number of token buckets
+ */
+template<uint32_t SLOTS>
+class LogRateLimiter
+{
+public:
+
+	///@brief What the caller has to print about earlier messages, before the one just checked if it's admitted
+	struct Notices
+	{
+		///@brief Number of collapsed repeats of the last message admitted, and its level and module
+		uint32_t m_repeats;
+		uint8_t m_repeatType;
+		uint8_t m_repeatModule;
+
+		///@brief Number of messages from the call site suppressed by its token bucket
+		uint32_t m_suppressed;
+	};
+
+	LogRateLimiter()
+	: m_rateInterval(0)
+	, m_rateTolerance(0)
+	, m_repeatWindow(0)
+	, m_repeatFormat(nullptr)
+	, m_repeatType(0)
+	, m_repeatModule(0)
+	, m_repeatStart(0)
+	, m_repeatCount(0)
+	{}
+
+	/**
+		@brief Sets the per call site rate limit
+
+		@param ticksPerSecond	Clock rate
+		@param perSecond		Sustained messages per second from one call site, or zero to disable rate limiting
+		@param burst			Number of messages which can be admitted back to back before the limit kicks in
+	 */
+	void SetRateLimit(uint32_t ticksPerSecond, uint32_t perSecond, uint32_t burst)
+	{
+		if(perSecond == 0)
+		{
+			m_rateInterval = 0;
+			return;
+		}
+
+		m_rateInterval = ticksPerSecond / perSecond;
+		if(m_rateInterval == 0)
+			m_rateInterval = 1;
+		m_rateTolerance = m_rateInterval * (burst ? burst - 1 : 0);
+
+		for(uint32_t i=0; i<SLOTS; i++)
+		{
+			m_rateSlots[i].m_format = nullptr;
+			m_rateSlots[i].m_tat = 0;
+			m_rateSlots[i].m_suppressed = 0;
+		}
+	}
+
+	///@brief Sets how long repeats of the last message admitted are collapsed for, or zero to disable collapsing
+	void SetRepeatWindow(uint64_t ticks)
+	{ m_repeatWindow = ticks; }
+
+	bool IsEnabled()
+	{ return m_repeatWindow || m_rateInterval; }
+
+	/**
+		@brief Decides whether a message should be printed
+
+		@param format	Format string of the call site
+		@param type		Message level
+		@param module	Module the message belongs to
+		@param now		Current time
+		@param notices	Filled in with anything to be printed first, even if the message isn't admitted
+
+		@return True if the message should be printed
+	 */
+	bool Admit(const char* format, uint8_t type, uint8_t module, uint64_t now, Notices& notices)
+	{
+		notices.m_repeats = 0;
+		notices.m_suppressed = 0;
+
+		//Collapse repeats of the last message admitted
+		if(m_repeatWindow)
+		{
+			if( (format == m_repeatFormat) && ( (now - m_repeatStart) < m_repeatWindow) )
+			{
+				m_repeatCount ++;
+				return false;
+			}
+
+			notices.m_repeats = TakeRepeats(notices.m_repeatType, notices.m_repeatModule);
+			m_repeatFormat = format;
+			m_repeatType = type;
+			m_repeatModule = module;
+			m_repeatStart = now;
+		}
+
+		//Token bucket for the call site. An idle slot is taken over, a busy one is shared.
+		if(m_rateInterval)
+		{
+			auto& slot = m_rateSlots[(reinterpret_cast<uintptr_t>(format) >> 2) % SLOTS];
+			if( (slot.m_format != format) && (slot.m_tat <= now) )
+				slot.m_format = format;
+
+			uint64_t tat = (slot.m_tat > now) ? slot.m_tat : now;
+			if( (tat - now) > m_rateTolerance)
+			{
+				slot.m_suppressed ++;
+
+				//Don't let a suppressed message swallow later repeats
+				if(m_repeatWindow)
+					m_repeatFormat = nullptr;
+				return false;
+			}
+			slot.m_tat = tat + m_rateInterval;
+
+			notices.m_suppressed = slot.m_suppressed;
+			slot.m_suppressed = 0;
+		}
+
+		return true;
+	}
+
+	/**
+		@brief Gets and clears the number of collapsed repeats of the last message admitted
+
+		@param type		Set to the level of the message, if there were any repeats
+		@param module	Set to the module of the message, if there were any repeats
+	 */
+	uint32_t TakeRepeats(uint8_t& type, uint8_t& module)
+	{
+		uint32_t count = m_repeatCount;
+		if(!count)
+			return 0;
+
+		m_repeatCount = 0;
+		m_repeatFormat = nullptr;
+		type = m_repeatType;
+		module = m_repeatModule;
+		return count;
+	}
+
+protected:
+
+	///@brief Token bucket for one or more call sites, stored as the theoretical arrival time of the next message (GCRA)
+	struct RateSlot
+	{
+		const char* m_format;
+		uint64_t m_tat;
+		uint32_t m_suppressed;
+	};
+	RateSlot m_rateSlots[SLOTS];
+
+	///@brief Ticks per token, and how far ahead of now the arrival time may run (burst size less one, in ticks)
+	uint64_t m_rateInterval;
+	uint64_t m_rateTolerance;
+
+	///@brief Repeat collapsing state for the last message admitted
+	uint64_t m_repeatWindow;
+	const char* m_repeatFormat;
+	uint8_t m_repeatType;
+	uint8_t m_repeatModule;
+	uint64_t m_repeatStart;
+	uint32_t m_repeatCount;
+};
+
+#endif
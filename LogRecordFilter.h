@@ -0,0 +1,75 @@
+/***********************************************************************************************************************
+*                                                                                                                      *
+* embedded-utils                                                                                                       *
+*                                                                                                                      *
+* Copyright (c) 2020-2025 Andrew D. Zonenberg                                                                          *
+* All rights reserved.                                                                                                 *
+*                                                                                                                      *
+* Redistribution and use in source and binary forms, with or without modification, are permitted provided that the     *
+* following conditions are met:                                                                                        *
+*                                                                                                                      *
+*    * Redistributions of source code must retain the above copyright notice, this list of conditions, and the         *
+*      following disclaimer.                                                                                           *
+*                                                                                                                      *
+*    * Redistributions in binary form must reproduce the above copyright notice, this list of conditions and the       *
+*      following disclaimer in the documentation and/or other materials provided with the distribution.                *
+*                                                                                                                      *
+*    * Neither the name of the author nor the names of any contributors may be used to endorse or promote products     *
+*      derived from this software without specific prior written permission.                                           *
+*                                                                                                                      *
+* THIS SOFTWARE IS PROVIDED BY THE AUTHORS "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED   *
+* TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL *
+* THE AUTHORS BE HELD LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES        *
+* (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR       *
+* BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT *
+* (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE       *
+* POSSIBILITY OF SUCH DAMAGE.                                                                                          *
+*                                                                                                                      *
+***********************************************************************************************************************/
+
+#ifndef LogRecordFilter_h
+#define LogRecordFilter_h
+
+#include <stdint.h>
+
+/**
+	@brief Interface for log targets which route output by the level and module of each message
+
+	Logger asks WantsRecord() before formatting anything, so a message nobody wants costs nothing beyond the call.
+	Output for each message it does format is bracketed by BeginRecord() and EndRecord(); anything written outside a
+	record (such as prompts or other direct output to the target) is not tied to any message.
+
+	WantsRecord() may be called from interrupts, so it must only look at the configuration and not change any state.
+	BeginRecord() and EndRecord() are only called at thread level.
+ */
+class LogRecordFilter
+{
+public:
+
+	///@brief Type passed for output not tied to any message, which every filter accepts
+	enum
+	{
+		NO_RECORD = 0xff
+	};
+
+	/**
+		@brief Checks if anything downstream wants a message of a given level (Logger::LogType) and module
+	 */
+	virtual bool WantsRecord(uint8_t type, uint8_t module) =0;
+
+	///@brief Called before the output for one message
+	virtual void BeginRecord(uint8_t type, uint8_t module) =0;
+
+	///@brief Called after the output for one message
+	virtual void EndRecord() =0;
+
+	/**
+		@brief Called when the logger switches between text lines and structured binary records
+
+		Binary records (see Logger::SetStructured()) each end with a zero byte rather than a newline.
+	 */
+	virtual void SetStructured(bool /*structured*/)
+	{}
+};
+
+#endif
@@ -0,0 +1,155 @@
+/***********************************************************************************************************************
+*                                                                                                                      *
+* embedded-utils                                                                                                       *
+*                                                                                                                      *
+* Copyright (c) 2020-2025 Andrew D. Zonenberg                                                                          *
+* All rights reserved.                                                                                                 *
+*                                                                                                                      *
+* Redistribution and use in source and binary forms, with or without modification, are permitted provided that the     *
+* following conditions are met:                                                                                        *
+*                                                                                                                      *
+*    * Redistributions of source code must retain the above copyright notice, this list of conditions, and the         *
+*      following disclaimer.                                                                                           *
+*                                                                                                                      *
+*    * Redistributions in binary form must reproduce the above copyright notice, this list of conditions and the       *
+*      following disclaimer in the documentation and/or other materials provided with the distribution.                *
+*                                                                                                                      *
+*    * Neither the name of the author nor the names of any contributors may be used to endorse or promote products     *
+*      derived from this software without specific prior written permission.                                           *
+*                                                                                                                      *
+* THIS SOFTWARE IS PROVIDED BY THE AUTHORS "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED   *
+* TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL *
+* THE AUTHORS BE HELD LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES        *
+* (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR       *
+* BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT *
+* (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE       *
+* POSSIBILITY OF SUCH DAMAGE.                                                                                          *
+*                                                                                                                      *
+***********************************************************************************************************************/
+
+#ifndef LogRecordFormatter_h
+#define LogRecordFormatter_h
+
+#include <stdint.h>
+#include "Cobs.h"
+#include "StringBuffer.h"
+
+//Longest message text in a structured record, which has a one byte length
+#ifndef LOGGER_STRUCTURED_MAX_TEXT
+#define LOGGER_STRUCTURED_MAX_TEXT 128
+#endif
+
+/**
+	@brief Formats log messages as binary records for machines to parse, rather than text with ANSI colors
+
+	A record is a type byte (RECORD_LOG_MESSAGE) followed by fields, each a tag byte, a length byte and the value:
+	uptime in microseconds, level, module, indent level, an ID for the call site (the format string address) and the
+	formatted text without the trailing newline. Integers are little endian, and tags the reader doesn't know can be
+	skipped by their length. Records are COBS encoded and each is followed by a zero byte, so a reader can
+	resynchronize at any point in the stream. tools/logrecord_decode.py turns a capture back into text or JSON.
+ */
+class LogRecordFormatter
+{
+public:
+
+	///@brief Record types
+	enum RecordType
+	{
+		RECORD_LOG_MESSAGE	= 0x01
+	};
+
+	///@brief Field tags
+	enum RecordTag
+	{
+		TAG_TIMESTAMP	= 0x01,		//uint64_t, microseconds of uptime
+		TAG_LEVEL		= 0x02,		//uint8_t, Logger::LogType
+		TAG_MODULE		= 0x03,		//uint8_t
+		TAG_INDENT		= 0x04,		//uint8_t
+		TAG_SITE		= 0x05,		//uint32_t, address of the format string
+		TAG_TEXT		= 0x06		//UTF-8 text, not null terminated
+	};
+
+	///@brief Size of a record before the text, which is the last field
+	static const uint32_t HEADER_SIZE = 1 + 10 + 3 + 3 + 3 + 6;
+
+	///@brief Largest record once encoded, including the delimiter
+	static const uint32_t MAX_SIZE = COBS_MAX_ENCODED_SIZE(HEADER_SIZE + 2 + LOGGER_STRUCTURED_MAX_TEXT) + 1;
+
+	static_assert(LOGGER_STRUCTURED_MAX_TEXT <= 255, "Structured record text has a one byte length");
+
+	/**
+		@brief Formats a message as a COBS encoded record, followed by the zero delimiter
+
+		Safe to call from an interrupt. The text is truncated if the record wouldn't otherwise fit.
+
+		@param out		Buffer for the record
+		@param size		Size of the buffer, at least HEADER_SIZE + 4
+		@param uptimeUs	Timestamp of the message
+		@param type		Message level
+		@param module	Module the message belongs to
+		@param indent	Indent level
+		@param format	Format string
+		@param list		Arguments
+
+		@return Length of the encoded record including the delimiter
+	 */
+	static uint32_t Format(
+		char* out,
+		uint32_t size,
+		uint64_t uptimeUs,
+		uint8_t type,
+		uint8_t module,
+		uint32_t indent,
+		const char* format,
+		__builtin_va_list list)
+	{
+		uint8_t record[HEADER_SIZE + 2 + LOGGER_STRUCTURED_MAX_TEXT + 1];
+		uint8_t* p = record;
+		*(p++) = RECORD_LOG_MESSAGE;
+
+		*(p++) = TAG_TIMESTAMP;
+		*(p++) = 8;
+		for(int i=0; i<8; i++)
+			*(p++) = uptimeUs >> (i*8);
+
+		*(p++) = TAG_LEVEL;
+		*(p++) = 1;
+		*(p++) = type;
+
+		*(p++) = TAG_MODULE;
+		*(p++) = 1;
+		*(p++) = module;
+
+		*(p++) = TAG_INDENT;
+		*(p++) = 1;
+		*(p++) = (indent < 0xff) ? indent : 0xff;
+
+		uint32_t site = reinterpret_cast<uintptr_t>(format);
+		*(p++) = TAG_SITE;
+		*(p++) = 4;
+		for(int i=0; i<4; i++)
+			*(p++) = site >> (i*8);
+
+		//Leave room for the worst case COBS overhead and the delimiter
+		uint32_t room = size - 2 - (size / 254) - HEADER_SIZE - 2;
+		if(room > LOGGER_STRUCTURED_MAX_TEXT)
+			room = LOGGER_STRUCTURED_MAX_TEXT;
+
+		//Render the text straight into the record, then drop the line ending since framing delimits records
+		StringBuffer buf(reinterpret_cast<char*>(p + 2), room + 1);
+		buf.Printf(format, list);
+		uint32_t len = buf.length();
+		while( (len > 0) && ( (p[len + 1] == '\n') || (p[len + 1] == '\r') ) )
+			len --;
+
+		*(p++) = TAG_TEXT;
+		*(p++) = len;
+		p += len;
+
+		uint32_t encoded = CobsEncode(record, p - record, reinterpret_cast<uint8_t*>(out));
+		out[encoded] = 0;
+		return encoded + 1;
+	}
+};
+
+#endif
@@ -30,23 +30,318 @@
 #ifndef LogSink_h
 #define LogSink_h
 
+#include <stdint.h>
+#include <string.h>
+#include "CharacterDevice.h"
+#include "LogRecordFilter.h"
+#include "InterruptContext.h"
 #include "../../embedded-cli/CLIOutputStream.h"
 
+/**
+	@brief Byte ring with free running positions, used as the queue between LogSink and a slow sink
+
+	Writes always succeed, overwriting the oldest data. Readers keep their own position, and can tell whether the data
+	they want is still there.
+
+	@tparam SIZE	Ring size in bytes, must be a power of two
+ */
+template<uint32_t SIZE>
+class LogSinkRing
+{
+public:
+	static_assert( (SIZE & (SIZE - 1)) == 0, "LogSinkRing size must be a power of two");
+
+	LogSinkRing()
+	: m_wptr(0)
+	, m_full(false)
+	{}
+
+	///@brief Position the next byte will be written at
+	uint32_t GetWritePosition()
+	{ return m_wptr; }
+
+	///@brief Position of the oldest byte still in the ring
+	uint32_t GetOldestPosition()
+	{ return m_full ? (m_wptr - SIZE) : 0; }
+
+	///@brief Checks if the data from a position up to the write position is all still in the ring
+	bool IsValid(uint32_t pos)
+	{ return (m_wptr - pos) <= (m_wptr - GetOldestPosition()); }
+
+	void Write(const char* data, uint32_t len)
+	{
+		if(len > SIZE)
+		{
+			m_wptr += len - SIZE;
+			data += len - SIZE;
+			len = SIZE;
+		}
+
+		uint32_t start = m_wptr & (SIZE - 1);
+		uint32_t first = SIZE - start;
+		if(first > len)
+			first = len;
+		memcpy(m_data + start, data, first);
+		memcpy(m_data, data + first, len - first);
+
+		if(!m_full && ( (m_wptr + len) >= SIZE) )
+			m_full = true;
+		m_wptr += len;
+	}
+
+	///@brief Copies len bytes starting at a position, which must be valid
+	void Read(uint32_t pos, char* out, uint32_t len)
+	{
+		uint32_t start = pos & (SIZE - 1);
+		uint32_t first = SIZE - start;
+		if(first > len)
+			first = len;
+		memcpy(out, m_data + start, first);
+		memcpy(out + first, m_data, len - first);
+	}
+
+	/**
+		@brief Finds the position just past the first delimiter at or after a valid position, or the write position if
+		none
+
+		The delimiter is a newline for text, or zero for binary records.
+	 */
+	uint32_t SkipPartialLine(uint32_t pos, char delim = '\n')
+	{
+		while(pos != m_wptr)
+		{
+			if(m_data[(pos++) & (SIZE - 1)] == delim)
+				break;
+		}
+		return pos;
+	}
+
+	///@brief Finds the first line (or record) start at or after a valid position
+	uint32_t AlignToLine(uint32_t pos, char delim = '\n')
+	{
+		//The very first byte written starts a line. Otherwise look at the byte before, if it's still in the ring.
+		if(!m_full && (pos == 0) )
+			return pos;
+		if( (pos != GetOldestPosition()) && (m_data[(pos - 1) & (SIZE - 1)] == delim) )
+			return pos;
+		return SkipPartialLine(pos, delim);
+	}
+
+	///@brief Finds the line (or record) aligned position to replay up to the last len bytes from
+	uint32_t GetReplayPosition(uint32_t len, char delim = '\n')
+	{
+		uint32_t start = GetOldestPosition();
+		if( (m_wptr - start) > len)
+			start = m_wptr - len;
+		return AlignToLine(start, delim);
+	}
+
+protected:
+	char m_data[SIZE];
+	uint32_t m_wptr;
+	bool m_full;
+};
+
+/**
+	@brief Level and module of the data in a LogSinkRing, as a ring of spans each starting where they changed
+
+	Only changes are recorded, so unfiltered output costs nothing. If the metadata changes more than COUNT times within
+	the data a reader still has to get through, the oldest span known is taken to cover everything before it too.
+
+	@tparam COUNT	Number of spans kept
+ */
+template<uint32_t COUNT>
+class LogSinkSpans
+{
+public:
+	struct Span
+	{
+		uint32_t m_start;
+		uint8_t m_type;
+		uint8_t m_module;
+	};
+
+	LogSinkSpans()
+	: m_count(1)
+	{
+		m_spans[0].m_start = 0;
+		m_spans[0].m_type = LogRecordFilter::NO_RECORD;
+		m_spans[0].m_module = 0;
+	}
+
+	///@brief Records that data written from a ring position on has the given metadata
+	void Mark(uint32_t pos, uint8_t type, uint8_t module)
+	{
+		auto& last = m_spans[(m_count - 1) % COUNT];
+		if( (last.m_type == type) && (last.m_module == module) )
+			return;
+
+		//Nothing was written with the last metadata, so just replace it
+		if(last.m_start == pos)
+		{
+			last.m_type = type;
+			last.m_module = module;
+			return;
+		}
+
+		auto& span = m_spans[m_count % COUNT];
+		span.m_start = pos;
+		span.m_type = type;
+		span.m_module = module;
+		m_count ++;
+	}
+
+	///@brief Finds the index of the span holding a ring position
+	uint32_t Find(uint32_t pos)
+	{
+		uint32_t oldest = (m_count > COUNT) ? (m_count - COUNT) : 0;
+		for(uint32_t i = m_count - 1; i != oldest; i--)
+		{
+			if(static_cast<int32_t>(pos - Get(i).m_start) >= 0)
+				return i;
+		}
+		return oldest;
+	}
+
+	///@brief Gets a span by index
+	const Span& Get(uint32_t i)
+	{ return m_spans[i % COUNT]; }
+
+	///@brief Finds where a span ends, given the ring's write position
+	uint32_t GetEnd(uint32_t i, uint32_t wptr)
+	{ return ( (i + 1) == m_count) ? wptr : Get(i + 1).m_start; }
+
+protected:
+	Span m_spans[COUNT];
+	uint32_t m_count;
+};
+
+/**
+	@brief Queue storage for LogSink: one ring per sink, plus a scrollback ring if SCROLLBACK is nonzero
+ */
+template<uint32_t MAX_SINKS, uint32_t SIZE, uint32_t SCROLLBACK, bool BROADCAST>
+class LogSinkQueues
+{
+public:
+	LogSinkRing<SIZE>& Get(uint32_t i)
+	{ return m_rings[i]; }
+
+	LogSinkRing<SCROLLBACK ? SCROLLBACK : 1>& GetHistory()
+	{ return m_history; }
+
+	LogSinkSpans<SCROLLBACK ? SCROLLBACK / 32 + 4 : 1>& GetSpans()
+	{ return m_spans; }
+
+protected:
+	LogSinkRing<SIZE> m_rings[MAX_SINKS];
+	LogSinkRing<SCROLLBACK ? SCROLLBACK : 1> m_history;
+	LogSinkSpans<SCROLLBACK ? SCROLLBACK / 32 + 4 : 1> m_spans;
+};
+
+/**
+	@brief Queue storage for LogSink in broadcast mode: one ring shared by every sink, which is also the scrollback
+ */
+template<uint32_t MAX_SINKS, uint32_t SIZE, uint32_t SCROLLBACK>
+class LogSinkQueues<MAX_SINKS, SIZE, SCROLLBACK, true>
+{
+public:
+	static_assert(SCROLLBACK <= SIZE, "LogSink scrollback can't be bigger than the shared ring in broadcast mode");
+
+	LogSinkRing<SIZE>& Get([[maybe_unused]] uint32_t i)
+	{ return m_ring; }
+
+	LogSinkRing<SIZE>& GetHistory()
+	{ return m_ring; }
+
+	LogSinkSpans<SIZE / 32 + 4>& GetSpans()
+	{ return m_spans; }
+
+protected:
+	LogSinkRing<SIZE> m_ring;
+	LogSinkSpans<SIZE / 32 + 4> m_spans;
+};
+
 /**
 	@brief A destination for Logger that can output to multiple CLIOutputStream's
 
+	Output goes straight to the primary device. For the other sinks it's collected in a line buffer, and each complete
+	line (or full buffer) is copied into a bounded queue per sink. Drain(), called from the idle loop, empties each
+	queue independently with one PutString() per chunk and one Flush() per sink, so network sinks see one packet per
+	batch rather than one per byte, and a slow or stalled sink never holds up the primary device or the other sinks.
+
+	When a sink's queue is full, either its oldest data is overwritten (DROP_OLDEST, the reader then skips forward to
+	the next whole line) or new lines are discarded (DROP_NEWEST). Either way the lost bytes are counted, and the sink
+	is told how many were lost the next time it's drained.
+
+	In broadcast mode there is a single ring of QUEUE_SIZE bytes instead, and each line is written to it once no matter
+	how many sinks are attached. Every sink keeps its own read position in the shared ring and drains at its own pace,
+	so memory and copying don't grow with the number of sinks. A sink which falls more than a ring behind is skipped
+	forward as with DROP_OLDEST, which is the only policy in this mode.
+
+	If SCROLLBACK is nonzero, the last SCROLLBACK bytes of output are kept so a newly added sink can be sent recent
+	history, starting from a whole line, before any live output. The replay is sent by Drain() in LINE_SIZE chunks like
+	everything else, so adding a sink costs nothing on the logging path. Per-sink queues get a separate scrollback ring
+	which every line is also copied into, and live output arriving during the replay waits in the sink's own queue.
+	In broadcast mode the shared ring already holds the history, so the new sink's read position simply starts
+	SCROLLBACK bytes back.
+
+	Each sink, and the primary device, can have a minimum level and a mask of modules it wants. Pass the LogSink to
+	Logger::SetRecordFilter() as well as making it the target, so it knows which message each line belongs to. Per-sink
+	queues only get the messages their sink wants. The shared ring and the scrollback take every message, tagged with
+	its level and module, and each reader skips what it doesn't want. Messages nobody wants aren't even formatted,
+	unless there's scrollback for a sink added later to want them. Output not from a Logger message goes to everyone.
+
+	Each complete line is sent to the sinks as soon as it's queued, the same as older versions which wrote to every
+	sink directly, unless the LogSink is written from an interrupt handler. To take slow sinks off the logging path,
+	call SetAutoDrain(false) and call Drain() from the idle loop instead; sinks then get nothing until Drain() or
+	Flush() runs. Partial lines, such as prompts, are held until Flush() is called.
+
+	When the logger sends structured binary records (Logger::SetStructured()), the zero byte ending each record takes
+	the place of the newline: readers skipped forward or replaying history start at a whole record instead.
+
 	TODO: look into refactoring Logger so it can write directly to a CLIOutputStream?
+
+	@tparam MAX_SINKS	Maximum number of CLIOutputStream's
+	@tparam LINE_SIZE	Longest line sent to the sinks in one piece
+	@tparam QUEUE_SIZE	Size of each sink's queue in bytes (or the shared ring in broadcast mode), must be a power of two
+	@tparam BROADCAST	True to share one ring between all sinks
+	@tparam SCROLLBACK	Bytes of history replayed to new sinks, must be zero or a power of two
  */
-template<uint32_t MAX_SINKS>
-class LogSink : public CharacterDevice
+template<
+	uint32_t MAX_SINKS,
+	uint32_t LINE_SIZE = 128,
+	uint32_t QUEUE_SIZE = 512,
+	bool BROADCAST = false,
+	uint32_t SCROLLBACK = 0>
+class LogSink
+	: public CharacterDevice
+	, public LogRecordFilter
 {
 public:
+	static_assert(LINE_SIZE <= QUEUE_SIZE, "LogSink queues must be able to hold a whole line");
+
+	///@brief What to do when a sink's queue is full
+	enum DropPolicy
+	{
+		DROP_OLDEST,
+		DROP_NEWEST
+	};
+
+	///@brief Mask accepting messages from every module
+	static const uint32_t ALL_MODULES = 0xffffffff;
 
 	LogSink(CharacterDevice* primary)
 		: m_primary(primary)
+		, m_lineLen(0)
+		, m_recordType(NO_RECORD)
+		, m_recordModule(0)
+		, m_primaryWants(true)
+		, m_delimiter('\n')
+		, m_autoDrain(true)
+		, m_draining(false)
 	{
 		for(uint32_t i=0; i<MAX_SINKS; i++)
-			m_sinks[i] = nullptr;
+			m_sinks[i].m_stream = nullptr;
 	}
 
 	///@brief unimplemented but the base class doesn't know that
@@ -54,15 +349,56 @@ public:
 	{ return 0; }
 
 	/**
-		@brief Adds a new log sink
+		@brief Adds a new log sink which gets every message
+
+		@param sink		The stream to send log output to
+		@param policy	What to do when the sink's queue is full
+		@param replay	True to send the scrollback history before live output
 	 */
-	void AddSink(CLIOutputStream* sink)
+	void AddSink(CLIOutputStream* sink, DropPolicy policy = DROP_OLDEST, bool replay = true)
+	{ AddSink(sink, 0, ALL_MODULES, policy, replay); }
+
+	/**
+		@brief Adds a new log sink which only gets some messages
+
+		@param sink			The stream to send log output to
+		@param minLevel		Lowest Logger::LogType the sink wants
+		@param moduleMask	Bit N set if the sink wants messages from module N. Modules from 31 up share bit 31.
+		@param policy		What to do when the sink's queue is full
+		@param replay		True to send the scrollback history before live output
+	 */
+	void AddSink(
+		CLIOutputStream* sink,
+		uint8_t minLevel,
+		uint32_t moduleMask = ALL_MODULES,
+		DropPolicy policy = DROP_OLDEST,
+		bool replay = true)
 	{
 		for(uint32_t i=0; i<MAX_SINKS; i++)
 		{
-			if(!m_sinks[i])
+			auto& s = m_sinks[i];
+			if(!s.m_stream)
 			{
-				m_sinks[i] = sink;
+				s.m_filter.m_minLevel = minLevel;
+				s.m_filter.m_moduleMask = moduleMask;
+				s.m_policy = policy;
+				s.m_rptr = m_queues.Get(i).GetWritePosition();
+				s.m_lostBytes = 0;
+				s.m_lostReported = 0;
+
+				auto& h = m_queues.GetHistory();
+				s.m_replayEnd = h.GetWritePosition();
+				s.m_replayPos = s.m_replayEnd;
+				if(SCROLLBACK && replay)
+				{
+					if constexpr(BROADCAST)
+						s.m_rptr = h.GetReplayPosition(SCROLLBACK, m_delimiter);
+					else
+						s.m_replayPos = h.GetReplayPosition(SCROLLBACK, m_delimiter);
+				}
+
+				//Set the stream last, WantsRecord() may be called from an interrupt
+				s.m_stream = sink;
 				break;
 			}
 		}
@@ -75,57 +411,411 @@ public:
 	{
 		for(uint32_t i=0; i<MAX_SINKS; i++)
 		{
-			if(m_sinks[i] == sink)
+			if(m_sinks[i].m_stream == sink)
 			{
-				m_sinks[i] = nullptr;
+				m_sinks[i].m_stream = nullptr;
 				break;
 			}
 		}
 	}
 
-	virtual void PrintBinary(char ch)
+	/**
+		@brief Sets the lowest level and the modules the primary device wants, it gets everything by default
+	 */
+	void SetPrimaryFilter(uint8_t minLevel, uint32_t moduleMask = ALL_MODULES)
+	{
+		m_primaryFilter.m_minLevel = minLevel;
+		m_primaryFilter.m_moduleMask = moduleMask;
+	}
+
+	/**
+		@brief Gets the number of bytes a sink has lost to a full queue since it was added
+	 */
+	uint32_t GetLostBytes(CLIOutputStream* sink)
 	{
-		m_primary->PrintBinary(ch);
 		for(uint32_t i=0; i<MAX_SINKS; i++)
 		{
-			if(m_sinks[i])
+			if(m_sinks[i].m_stream == sink)
+				return m_sinks[i].m_lostBytes;
+		}
+		return 0;
+	}
+
+	virtual bool WantsRecord(uint8_t type, uint8_t module) override
+	{
+		//Anything kept for replay might be wanted by a sink added later
+		if(SCROLLBACK || m_primaryFilter.Matches(type, module))
+			return true;
+		for(uint32_t i=0; i<MAX_SINKS; i++)
+		{
+			if(m_sinks[i].m_stream && m_sinks[i].m_filter.Matches(type, module))
+				return true;
+		}
+		return false;
+	}
+
+	virtual void BeginRecord(uint8_t type, uint8_t module) override
+	{
+		FlushLine();
+		m_recordType = type;
+		m_recordModule = module;
+		m_primaryWants = m_primaryFilter.Matches(type, module);
+	}
+
+	virtual void EndRecord() override
+	{
+		FlushLine();
+		m_recordType = NO_RECORD;
+		m_recordModule = 0;
+		m_primaryWants = true;
+	}
+
+	///@brief Resynchronizes sinks on record delimiters rather than newlines while the logger sends binary records
+	virtual void SetStructured(bool structured) override
+	{ m_delimiter = structured ? '\0' : '\n'; }
+
+	virtual void PrintBinary(char ch) override
+	{
+		if(m_primaryWants)
+			m_primary->PrintBinary(ch);
+		Append(ch);
+	}
+
+	virtual void PrintText(char ch) override
+	{
+		if(m_primaryWants)
+			m_primary->PrintText(ch);
+		Append(ch);
+	}
+
+	virtual void PrintString(const char* str) override
+	{
+		if(m_primaryWants)
+			m_primary->PrintString(str);
+		while(*str)
+			Append(*(str++));
+	}
+
+	virtual void Write(const char* data, uint32_t len) override
+	{
+		if(m_primaryWants)
+			m_primary->Write(data, len);
+		for(uint32_t i=0; i<len; i++)
+			Append(data[i]);
+	}
+
+	/**
+		@brief Sends any partial line to the sinks right away, and flushes the primary device
+	 */
+	virtual void Flush() override
+	{
+		FlushLine();
+		Drain();
+		m_primary->Flush();
+	}
+
+	/**
+		@brief Sets whether lines are sent to the sinks as soon as they're queued (the default)
+
+		With auto drain off, nothing reaches the sinks until Drain() or Flush() is called.
+	 */
+	void SetAutoDrain(bool autoDrain)
+	{ m_autoDrain = autoDrain; }
+
+	/**
+		@brief Sends everything queued to each sink. Call this from the idle loop if auto drain is off.
+
+		Must not be called from an interrupt. Output a sink generates while being drained (e.g. by logging) is queued
+		and goes out on the next Drain().
+	 */
+	void Drain()
+	{
+		if(m_draining)
+			return;
+		m_draining = true;
+
+		for(uint32_t i=0; i<MAX_SINKS; i++)
+		{
+			if(m_sinks[i].m_stream)
+				DrainSink(m_sinks[i], m_queues.Get(i));
+		}
+
+		m_draining = false;
+	}
+
+protected:
+
+	///@brief Which messages a sink wants
+	struct Filter
+	{
+		uint8_t m_minLevel = 0;
+		uint32_t m_moduleMask = ALL_MODULES;
+
+		bool Matches(uint8_t type, uint8_t module) const
+		{
+			if(type == NO_RECORD)
+				return true;
+			return (type >= m_minLevel) && (m_moduleMask & (1u << ( (module < 31) ? module : 31) ) );
+		}
+	};
+
+	struct Sink
+	{
+		CLIOutputStream* m_stream;
+		DropPolicy m_policy;
+		Filter m_filter;
+
+		///@brief Read position in the sink's queue
+		uint32_t m_rptr;
+
+		///@brief Bytes lost since the sink was added, and how many of them the sink has been told about
+		uint32_t m_lostBytes;
+		uint32_t m_lostReported;
+
+		///@brief Queue position where the first unreported loss happened
+		uint32_t m_gapPos;
+
+		///@brief Scrollback still to be replayed, per-sink queue mode only
+		uint32_t m_replayPos;
+		uint32_t m_replayEnd;
+	};
+
+	void Append(char ch)
+	{
+		m_line[m_lineLen++] = ch;
+		if( (ch == m_delimiter) || (m_lineLen == LINE_SIZE) )
+			FlushLine();
+	}
+
+	/**
+		@brief Queues the line buffer for the sinks, and sends it to them right away if auto drain is on
+	 */
+	void FlushLine()
+	{
+		if(!m_lineLen)
+			return;
+
+		QueueLine();
+		if(m_autoDrain && !InInterruptHandler())
+			Drain();
+	}
+
+	/**
+		@brief Copies the line buffer into the queue of every sink which wants it, or the shared ring
+	 */
+	void QueueLine()
+	{
+		uint32_t len = m_lineLen;
+		m_lineLen = 0;
+
+		//Readers which fall behind are detected when they're drained
+		if constexpr(BROADCAST || (SCROLLBACK != 0) )
+		{
+			auto& h = m_queues.GetHistory();
+			m_queues.GetSpans().Mark(h.GetWritePosition(), m_recordType, m_recordModule);
+			h.Write(m_line, len);
+		}
+		if constexpr(BROADCAST)
+			return;
+
+		for(uint32_t i=0; i<MAX_SINKS; i++)
+		{
+			auto& s = m_sinks[i];
+			if(!s.m_stream || !s.m_filter.Matches(m_recordType, m_recordModule))
+				continue;
+
+			auto& q = m_queues.Get(i);
+			uint32_t used = q.GetWritePosition() - s.m_rptr;
+			if( (s.m_policy == DROP_NEWEST) && ( (QUEUE_SIZE - used) < len) )
 			{
-				m_sinks[i]->PutCharacter(ch);
-				m_sinks[i]->Flush();
+				if(s.m_lostBytes == s.m_lostReported)
+					s.m_gapPos = q.GetWritePosition();
+				s.m_lostBytes += len;
 			}
+			else
+				q.Write(m_line, len);
 		}
 	}
 
-	virtual void PrintText(char ch)
+	/**
+		@brief Sends part of a ring to a sink in chunks of up to LINE_SIZE bytes
+
+		@param s	The sink
+		@param r	Ring to read from
+		@param pos	Position to start at, advanced to end
+		@param end	Position to stop at
+	 */
+	template<class Ring>
+	void SendRange(Sink& s, Ring& r, uint32_t& pos, uint32_t end)
 	{
-		m_primary->PrintText(ch);
-		for(uint32_t i=0; i<MAX_SINKS; i++)
+		while(pos != end)
 		{
-			if(m_sinks[i])
+			uint32_t len = end - pos;
+			if(len > LINE_SIZE)
+				len = LINE_SIZE;
+
+			r.Read(pos, m_chunk, len);
+			m_chunk[len] = '\0';
+			pos += len;
+
+			//Streams only take null terminated strings, so zero bytes (such as the delimiters between binary log
+			//records) are sent on their own between the runs of text
+			const char* p = m_chunk;
+			const char* chunkEnd = m_chunk + len;
+			while(p < chunkEnd)
 			{
-				m_sinks[i]->PutCharacter(ch);
-				m_sinks[i]->Flush();
+				if(*p)
+				{
+					s.m_stream->PutString(p);
+					p += FastStrlen(p);
+				}
+				else
+				{
+					s.m_stream->PutCharacter('\0');
+					p ++;
+				}
 			}
 		}
 	}
 
-	virtual void PrintString(const char* str)
+	/**
+		@brief Sends the part of the shared ring or scrollback a sink wants, skipping the rest
+
+		@return True if anything was sent
+	 */
+	template<class Ring>
+	bool SendFiltered(Sink& s, Ring& r, uint32_t& pos, uint32_t end)
 	{
-		m_primary->PrintString(str);
-		for(uint32_t i=0; i<MAX_SINKS; i++)
+		bool sent = false;
+		auto& spans = m_queues.GetSpans();
+		uint32_t i = spans.Find(pos);
+		while(pos != end)
+		{
+			auto& span = spans.Get(i);
+			uint32_t spanEnd = spans.GetEnd(i, r.GetWritePosition());
+			if(static_cast<int32_t>(end - spanEnd) < 0)
+				spanEnd = end;
+
+			if(s.m_filter.Matches(span.m_type, span.m_module) && (pos != spanEnd) )
+			{
+				SendRange(s, r, pos, spanEnd);
+				sent = true;
+			}
+			pos = spanEnd;
+			i ++;
+		}
+		return sent;
+	}
+
+	/**
+		@brief Sends everything queued for one sink
+
+		A notice of how much was lost is sent where the gap is. Any scrollback still to be replayed goes first.
+	 */
+	void DrainSink(Sink& s, LogSinkRing<QUEUE_SIZE>& q)
+	{
+		bool sent = false;
+		if constexpr(!BROADCAST && (SCROLLBACK != 0) )
 		{
-			if(m_sinks[i])
+			if(s.m_replayPos != s.m_replayEnd)
+			{
+				//Nothing is written to the history while we drain, so it only needs checking once
+				auto& h = m_queues.GetHistory();
+				if(!h.IsValid(s.m_replayPos))
+					s.m_replayPos = h.SkipPartialLine(h.GetOldestPosition(), m_delimiter);
+				if(static_cast<int32_t>(s.m_replayEnd - s.m_replayPos) < 0)
+					s.m_replayPos = s.m_replayEnd;
+
+				if(SendFiltered(s, h, s.m_replayPos, s.m_replayEnd))
+					sent = true;
+			}
+		}
+
+		//If the writer lapped us, skip to the first whole line (or record) still in the queue
+		if(!q.IsValid(s.m_rptr))
+		{
+			uint32_t next = q.SkipPartialLine(q.GetOldestPosition(), m_delimiter);
+			if(s.m_lostBytes == s.m_lostReported)
+				s.m_gapPos = next;
+			s.m_lostBytes += next - s.m_rptr;
+			s.m_rptr = next;
+		}
+
+		uint32_t wptr = q.GetWritePosition();
+		while(true)
+		{
+			bool gap = (s.m_lostBytes != s.m_lostReported);
+			if(gap && (s.m_rptr == s.m_gapPos) )
+			{
+				char num[12];
+				utoa(s.m_lostBytes - s.m_lostReported, num);
+				s.m_lostReported = s.m_lostBytes;
+				gap = false;
+
+				s.m_stream->PutString("\n[");
+				s.m_stream->PutString(num);
+				s.m_stream->PutString(" bytes of log output lost]\n");
+
+				//Keep the notice out of the next binary record
+				if(m_delimiter == '\0')
+					s.m_stream->PutCharacter('\0');
+				sent = true;
+			}
+
+			if(s.m_rptr == wptr)
+				break;
+
+			//Send up to the gap if there is one
+			uint32_t end = wptr;
+			if(gap && ( (s.m_gapPos - s.m_rptr) < (wptr - s.m_rptr) ) )
+				end = s.m_gapPos;
+
+			//The shared ring holds everyone's messages, the per-sink queues only what the sink wants
+			if constexpr(BROADCAST)
+			{
+				if(SendFiltered(s, q, s.m_rptr, end))
+					sent = true;
+			}
+			else
 			{
-				m_sinks[i]->PutString(str);
-				m_sinks[i]->Flush();
+				SendRange(s, q, s.m_rptr, end);
+				sent = true;
 			}
 		}
+
+		if(sent)
+			s.m_stream->Flush();
 	}
 
 protected:
 	CharacterDevice* m_primary;
+	Filter m_primaryFilter;
+
+	Sink m_sinks[MAX_SINKS];
+	LogSinkQueues<MAX_SINKS, QUEUE_SIZE, SCROLLBACK, BROADCAST> m_queues;
+
+	///@brief Output not yet queued for the sinks
+	char m_line[LINE_SIZE];
+	uint32_t m_lineLen;
+
+	///@brief Level and module of the message being written, or NO_RECORD
+	uint8_t m_recordType;
+	uint8_t m_recordModule;
+
+	///@brief True if the primary device wants the message being written
+	bool m_primaryWants;
+
+	///@brief End of a line, or of a record when the logger sends binary records
+	char m_delimiter;
+
+	///@brief True to send each line to the sinks as soon as it's queued
+	bool m_autoDrain;
+
+	///@brief Set while sinks are being drained
+	bool m_draining;
 
-	CLIOutputStream* m_sinks[MAX_SINKS];
+	///@brief Staging for one chunk on its way to a sink, plus a null terminator
+	char m_chunk[LINE_SIZE + 1];
 };
 
 #endif
@@ -28,8 +28,13 @@
 ***********************************************************************************************************************/
 
 #include <stdint.h>
+#include <string.h>
 #include "Logger.h"
 
+#if defined(LOGGER_ASYNC_DEPTH) || defined(LOGGER_ISR_DEPTH)
+#include "StringBuffer.h"
+#endif
+
 #ifdef LOGGER_USE_RTC_TIMESTAMP
 #include <stm32.h>
 #include <peripheral/RTC.h>
@@ -37,77 +42,511 @@
 
 #ifdef HAVE_TIM
 
-void Logger::Timestamp(LogType type)
+#if defined(LOGGER_ASYNC_DEPTH) || defined(LOGGER_ISR_DEPTH)
+
+/**
+	@brief Gets the length of a message formatted into a buffer, keeping the line break on truncated lines so the next
+	message starts cleanly
+
+	@param buf	StringBuffer the message was formatted into
+	@param text	Backing array of buf, which isn't null terminated. Only the returned length is valid.
+ */
+static uint32_t FinishLine(StringBuffer& buf, char* text)
 {
-	//Print the prefix for the log message
-	switch(type)
+	uint32_t len = buf.length();
+	if(buf.Overflowed() && (len >= 2) )
 	{
-		case NORMAL:
-			m_target->Printf("[\033[32m");
-			break;
+		text[len-2] = '\r';
+		text[len-1] = '\n';
+	}
+	return len;
+}
 
-		case WARNING:
-			m_target->Printf("[\033[33;1m");
-			break;
+#endif
 
-		case ERROR:
-			m_target->Printf("[\033[31;1m");
-			break;
-	}
+/**
+	@brief Common back end for all of the operator() overloads
 
-	#ifdef LOGGER_USE_RTC_TIMESTAMP
+	@param type		Message level
+	@param module	Module the message belongs to
+	@param format	Format string
+	@param list		Arguments
+	@param fromISR	True if the caller is known to be an interrupt handler
+ */
+void Logger::Log(
+	LogType type,
+	uint8_t module,
+	const char* format,
+	__builtin_va_list list,
+	[[maybe_unused]] bool fromISR)
+{
+	if(!m_target)
+		return;
+	if(m_filter && !m_filter->WantsRecord(type, module))
+		return;
 
-		//this assumes RTC sub-second counter is 10 kHz ticks for now, should we find a way to change this later?
-		tm rtctime;
-		uint16_t rtcsubsec;
-		RTC::GetTime(rtctime, rtcsubsec);
+	#ifdef LOGGER_STATS
+		uint32_t start = GetStatsTime();
+		m_stats.m_messages[type] ++;
 
-		m_target->Printf("%04d-%02d-%02dT%02d:%02d:%02d.%04d\033[0m] ",
-			rtctime.tm_year + 1900,
-			rtctime.tm_mon+1,
-			rtctime.tm_mday,
-			rtctime.tm_hour,
-			rtctime.tm_min,
-			rtctime.tm_sec,
-			rtcsubsec);
+		Dispatch(type, module, format, list, fromISR);
 
+		uint32_t dt = GetStatsTime() - start;
+		m_stats.m_busyTime += dt;
+		if(dt > m_stats.m_maxTime)
+			m_stats.m_maxTime = dt;
 	#else
+		Dispatch(type, module, format, list, fromISR);
+	#endif
+}
 
-		//TODO: support printf %ld and use int64 here
-		uint32_t uptime = (m_timeOffset + m_timer->GetCount()) / 10;
-		m_target->Printf("%8d.%03d\033[0m] ", uptime / 1000, uptime % 1000);
+/**
+	@brief Routes a message to the interrupt ring, or through filtering to the target
+ */
+void Logger::Dispatch(
+	LogType type,
+	uint8_t module,
+	const char* format,
+	__builtin_va_list list,
+	[[maybe_unused]] bool fromISR)
+{
+	#ifdef LOGGER_ISR_DEPTH
+		if(fromISR || InInterruptHandler())
+		{
+			LogFromISR(type, module, format, list);
+			return;
+		}
+	#endif
 
+	#ifdef LOGGER_RATE_LIMIT_SLOTS
+		if(!Admit(type, module, format))
+			return;
 	#endif
+
+	Emit(type, module, format, list);
 }
 
-void Logger::PrintIndent()
+/**
+	@brief Sends a message which has passed all filtering to the target, or the staging FIFO in async mode
+ */
+void Logger::Emit(LogType type, uint8_t module, const char* format, __builtin_va_list list)
 {
-	for(uint32_t i=0; i<m_indentLevel; i++)
-		m_target->PrintString("    ");
+	//Anything logged from interrupts so far goes out first, to keep the output in order
+	#ifdef LOGGER_ISR_DEPTH
+		if(m_isr.IsPending())
+			DrainISR();
+	#endif
+
+	#ifdef LOGGER_STRUCTURED
+		if(m_structured)
+		{
+			char record[LogRecordFormatter::MAX_SIZE];
+			uint32_t len = LogRecordFormatter::Format(
+				record, sizeof(record), m_clock.GetMicroseconds(), type, module, m_indentLevel, format, list);
+			EmitRaw(type, module, record, len);
+			return;
+		}
+	#endif
+
+	#ifdef LOGGER_ASYNC_DEPTH
+		if(m_async)
+		{
+			//Format the whole message now, so the timestamp reflects when it was logged
+			char line[LOGGER_ASYNC_MAX_LINE];
+			StringBuffer buf(line, sizeof(line));
+			Format(&buf, type, format, list);
+			EmitRaw(type, module, line, FinishLine(buf, line));
+			return;
+		}
+	#endif
+
+	if(m_filter)
+		m_filter->BeginRecord(type, module);
+
+	#ifdef LOGGER_STATS
+		Format(&m_statsCounter, type, format, list);
+	#else
+		Format(m_target, type, format, list);
+	#endif
+
+	if(m_filter)
+		m_filter->EndRecord();
 }
 
+#ifdef LOGGER_ISR_DEPTH
+
 /**
-	@brief Updates the internal offset if the timer is getting close to wrapping, then reset the timer
+	@brief Formats a message from an interrupt into the next slot of the interrupt record ring
+
+	Only claiming the slot is interlocked, and that's a handful of instructions. Formatting is done with interrupts
+	enabled, so a higher priority interrupt can claim the following slot meanwhile. The slot is marked complete by
+	setting its length last.
  */
-void Logger::UpdateOffset()
+void Logger::LogFromISR(LogType type, uint8_t module, const char* format, __builtin_va_list list)
 {
-	m_timeOffset += m_timer->GetCount();
-	m_timer->Restart();
+	auto slot = m_isr.Claim(type, module);
+	if(!slot)
+	{
+		#ifdef LOGGER_STATS
+			m_stats.m_dropped ++;
+		#endif
+		return;
+	}
+
+	uint32_t len;
+	#ifdef LOGGER_STRUCTURED
+	if(m_structured)
+	{
+		len = LogRecordFormatter::Format(
+			slot->m_text,
+			sizeof(slot->m_text),
+			m_clock.GetMicroseconds(),
+			type,
+			module,
+			m_indentLevel,
+			format,
+			list);
+	}
+	else
+	#endif
+	{
+		StringBuffer buf(slot->m_text, sizeof(slot->m_text));
+		Format(&buf, type, format, list, false);
+		len = FinishLine(buf, slot->m_text);
+	}
+
+	m_isr.Commit(slot, len);
 }
 
 /**
-	@brief Updates the internal offset if the timer is getting close to wrapping, then reset the timer
+	@brief Sends everything logged from interrupts to the target, in the order the slots were claimed
+
+	Called automatically before each message logged at thread level. Call it from the idle loop too, so interrupt
+	messages still go out when nothing else is being logged. Must not be called from an interrupt.
  */
-bool Logger::UpdateOffset(uint32_t threshold)
+void Logger::DrainISR()
 {
-	uint32_t timestamp = m_timer->GetCount();
-	if(timestamp >= threshold)
+	//Stops at a slot which has been claimed but not finished yet
+	while(auto slot = m_isr.Peek())
 	{
-		m_timeOffset += timestamp;
-		m_timer->Restart();
+		EmitRaw(static_cast<LogType>(slot->m_type), slot->m_module, slot->m_text, slot->m_len);
+		m_isr.Pop();
+	}
+
+	if(uint32_t dropped = m_isr.TakeDropped())
+		Notice(WARNING, MODULE_DEFAULT, "%d messages from interrupts dropped\n", dropped);
+}
+
+#endif
+
+/**
+	@brief Sends an already formatted message to the target, or the staging FIFO in async mode
+ */
+void Logger::EmitRaw(LogType type, uint8_t module, const char* text, uint32_t len)
+{
+	#ifdef LOGGER_ASYNC_DEPTH
+		if(m_async)
+		{
+			//Only thread level code pushes, so the header and text can't be split up if there's room for both
+			char header[4] = { static_cast<char>(type), static_cast<char>(module),
+				static_cast<char>(len & 0xff), static_cast<char>(len >> 8) };
+			if( (m_asyncFifo.size() + sizeof(header) + len) <= LOGGER_ASYNC_DEPTH)
+			{
+				m_asyncFifo.PushBlock(header, sizeof(header));
+				m_asyncFifo.PushBlock(text, len);
+				#ifdef LOGGER_STATS
+					m_stats.m_bytes += len;
+				#endif
+			}
+			else
+			{
+				m_asyncDropped ++;
+				#ifdef LOGGER_STATS
+					m_stats.m_dropped ++;
+				#endif
+			}
+			return;
+		}
+	#endif
+
+	#ifdef LOGGER_STATS
+		m_stats.m_bytes += len;
+	#endif
+
+	if(m_filter)
+		m_filter->BeginRecord(type, module);
+	m_target->Write(text, len);
+	if(m_filter)
+		m_filter->EndRecord();
+}
+
+/**
+	@brief Emits a message generated by the logger itself, bypassing all filtering
+ */
+void Logger::Notice(LogType type, uint8_t module, const char* format, ...)
+{
+	__builtin_va_list list;
+	__builtin_va_start(list, format);
+	Emit(type, module, format, list);
+	__builtin_va_end(list);
+}
+
+#ifdef LOGGER_RATE_LIMIT_SLOTS
+
+/**
+	@brief Decides whether a message from a call site should be printed, without formatting it
+
+	@return True if the message should be printed
+ */
+bool Logger::Admit(LogType type, uint8_t module, const char* format)
+{
+	//Both limits are off by default
+	if(!m_limiter.IsEnabled())
 		return true;
+
+	LogRateLimiter<LOGGER_RATE_LIMIT_SLOTS>::Notices notices;
+	bool admit = m_limiter.Admit(format, type, module, m_clock.GetTicks(), notices);
+
+	if(notices.m_repeats)
+	{
+		Notice(
+			static_cast<LogType>(notices.m_repeatType),
+			notices.m_repeatModule,
+			"last message repeated %d times\n",
+			notices.m_repeats);
 	}
-	return false;
+	if(notices.m_suppressed)
+		Notice(WARNING, module, "%d messages suppressed by rate limit\n", notices.m_suppressed);
+
+	#ifdef LOGGER_STATS
+		if(!admit)
+			m_stats.m_suppressed ++;
+	#endif
+
+	return admit;
+}
+
+/**
+	@brief Prints the summary for collapsed repeats of the last message, if there were any
+
+	Call this from the idle loop so the summary isn't held until the next message.
+ */
+void Logger::FlushRepeats()
+{
+	if(!m_target)
+		return;
+
+	uint8_t type;
+	uint8_t module;
+	if(uint32_t count = m_limiter.TakeRepeats(type, module))
+		Notice(static_cast<LogType>(type), module, "last message repeated %d times\n", count);
+}
+
+#endif
+
+/**
+	@brief Prints a complete log message, including timestamp and indentation, to a device
+ */
+void Logger::Format(
+	CharacterDevice* target,
+	LogType type,
+	const char* format,
+	__builtin_va_list list,
+	bool useCache)
+{
+	Timestamp(target, type, useCache);
+	PrintIndent(target);
+	target->Printf(format, list);
+}
+
+#ifdef LOGGER_ASYNC_DEPTH
+/**
+	@brief Sends everything staged in async mode to the target
+
+	Call this from the idle loop.
+ */
+void Logger::Drain()
+{
+	if(!m_target)
+		return;
+
+	#ifdef LOGGER_ISR_DEPTH
+		DrainISR();
+	#endif
+
+	//Messages are always pushed whole, so a header is never split from its text
+	char header[4];
+	while(m_asyncFifo.PopBlock(header, sizeof(header)) == sizeof(header))
+	{
+		uint32_t len = static_cast<uint8_t>(header[2]) | (static_cast<uint8_t>(header[3]) << 8);
+		if(m_filter)
+			m_filter->BeginRecord(static_cast<uint8_t>(header[0]), static_cast<uint8_t>(header[1]));
+
+		char chunk[64];
+		while(len)
+		{
+			uint32_t n = m_asyncFifo.PopBlock(chunk, (len < sizeof(chunk)) ? len : sizeof(chunk));
+			if(!n)
+				break;
+			m_target->Write(chunk, n);
+			len -= n;
+		}
+
+		if(m_filter)
+			m_filter->EndRecord();
+	}
+
+	if(m_asyncDropped)
+	{
+		uint32_t dropped = m_asyncDropped;
+		m_asyncDropped = 0;
+
+		//Send the notice straight to the target rather than staging it again
+		bool async = m_async;
+		m_async = false;
+		Notice(WARNING, MODULE_DEFAULT, "%d messages dropped\n", dropped);
+		m_async = async;
+	}
+}
+#endif
+
+/**
+	@brief Start of the timestamp for each LogType: opening bracket plus ANSI color, with lengths precomputed
+ */
+#define LOG_PREFIX(s) { s, sizeof(s) - 1 }
+static const struct
+{
+	const char* text;
+	uint32_t len;
+} g_logPrefix[] =
+{
+	LOG_PREFIX("[\033[90m"),		//LOG_LEVEL_TRACE
+	LOG_PREFIX("[\033[36m"),		//LOG_LEVEL_DEBUG
+	LOG_PREFIX("[\033[32m"),		//NORMAL
+	LOG_PREFIX("[\033[33;1m"),	//WARNING
+	LOG_PREFIX("[\033[31;1m")		//ERROR
+};
+#undef LOG_PREFIX
+
+static const char g_logSuffix[] = "\033[0m] ";
+
+#ifdef LOGGER_USE_RTC_TIMESTAMP
+
+/**
+	@brief Writes exactly ndigits decimal digits, including leading zeros, without a terminator
+ */
+static void PutDigits(char* s, uint32_t n, int ndigits)
+{
+	for(int i=ndigits-1; i>=0; i--)
+	{
+		s[i] = '0' + (n % 10);
+		n /= 10;
+	}
+}
+
+/**
+	@brief Renders the fields of a "YYYY-MM-DDTHH:MM:SS." string which differ from a previous time
+
+	@param text		String to render into
+	@param rtctime	Time to render
+	@param last		Time text was last rendered from, or null to render everything
+ */
+static void RenderRtcText(char* text, const tm& rtctime, const tm* last)
+{
+	if(!last)
+		memcpy(text, "0000-00-00T00:00:00.", 20);
+
+	if(!last || (rtctime.tm_year != last->tm_year) )
+		PutDigits(text + 0, rtctime.tm_year + 1900, 4);
+	if(!last || (rtctime.tm_mon != last->tm_mon) )
+		PutDigits(text + 5, rtctime.tm_mon + 1, 2);
+	if(!last || (rtctime.tm_mday != last->tm_mday) )
+		PutDigits(text + 8, rtctime.tm_mday, 2);
+	if(!last || (rtctime.tm_hour != last->tm_hour) )
+		PutDigits(text + 11, rtctime.tm_hour, 2);
+	if(!last || (rtctime.tm_min != last->tm_min) )
+		PutDigits(text + 14, rtctime.tm_min, 2);
+	PutDigits(text + 17, rtctime.tm_sec, 2);
+}
+
+/**
+	@brief Re-renders the fields of the cached "YYYY-MM-DDTHH:MM:SS." string which differ from the last message
+ */
+void Logger::UpdateRtcText(const tm& rtctime)
+{
+	RenderRtcText(m_rtcText, rtctime, m_rtcTextValid ? &m_rtcLast : nullptr);
+	m_rtcTextValid = true;
+	m_rtcLast = rtctime;
+}
+
+#endif
+
+/**
+	@brief Prints the timestamp and color for a message
+
+	@param target	Device to print to
+	@param type		Message level
+	@param useCache	False when called from an interrupt, so the RTC text cache owned by thread level isn't touched
+ */
+void Logger::Timestamp(CharacterDevice* target, LogType type, bool useCache)
+{
+	const auto& prefix = g_logPrefix[type];
+
+	#ifdef LOGGER_USE_RTC_TIMESTAMP
+
+		//this assumes RTC sub-second counter is 10 kHz ticks for now, should we find a way to change this later?
+		tm rtctime;
+		uint16_t rtcsubsec;
+		RTC::GetTime(rtctime, rtcsubsec);
+
+		//Only the fields which changed since the last message get re-rendered
+		const char* text = m_rtcText;
+		char uncached[sizeof(m_rtcText)];
+		if(!useCache)
+		{
+			RenderRtcText(uncached, rtctime, nullptr);
+			text = uncached;
+		}
+		else if(!m_rtcTextValid || (rtctime.tm_sec != m_rtcLast.tm_sec) || (rtctime.tm_min != m_rtcLast.tm_min) ||
+			(rtctime.tm_hour != m_rtcLast.tm_hour) || (rtctime.tm_mday != m_rtcLast.tm_mday) ||
+			(rtctime.tm_mon != m_rtcLast.tm_mon) || (rtctime.tm_year != m_rtcLast.tm_year) )
+		{
+			UpdateRtcText(rtctime);
+		}
+
+		//Assemble the whole timestamp and send it in one go
+		char line[16 + sizeof(m_rtcText) + 4 + sizeof(g_logSuffix)];	//longest prefix is 8 bytes
+		char* p = line;
+		memcpy(p, prefix.text, prefix.len);
+		p += prefix.len;
+		memcpy(p, text, sizeof(m_rtcText));
+		p += sizeof(m_rtcText);
+		PutDigits(p, rtcsubsec, 4);
+		p += 4;
+		memcpy(p, g_logSuffix, sizeof(g_logSuffix) - 1);
+		p += sizeof(g_logSuffix) - 1;
+		target->Write(line, p - line);
+
+	#else
+
+		(void)useCache;
+		target->Write(prefix.text, prefix.len);
+
+		uint64_t ticks = m_clock.GetTicks();
+		uint32_t rate = m_clock.GetTicksPerSecond();
+		uint32_t frac = static_cast<uint64_t>(ticks % rate) * m_fracScale / rate;
+		if(m_fracDigits)
+			target->Printf("%8llu.%0*u\033[0m] ", ticks / rate, m_fracDigits, frac);
+		else
+			target->Printf("%8llu\033[0m] ", ticks / rate);
+
+	#endif
+}
+
+void Logger::PrintIndent(CharacterDevice* target)
+{
+	for(uint32_t i=0; i<m_indentLevel; i++)
+		target->PrintString("    ");
 }
 
 #endif
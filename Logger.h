@@ -31,6 +31,9 @@
 #define logger_h
 
 #include "CharacterDevice.h"
+#include "MonotonicClock.h"
+#include "LogRecordFilter.h"
+#include "InterruptContext.h"
 
 //For now, assume any ARM platform is STM32 and anything else is antikernel-ipcores
 #ifdef __arm__
@@ -41,8 +44,97 @@
 
 #ifdef HAVE_TIM
 
+#ifdef LOGGER_USE_RTC_TIMESTAMP
+#include <time.h>
+#endif
+
+#ifdef LOGGER_ASYNC_DEPTH
+#include "FIFO.h"
+
+//Longest single message, including timestamp and indentation, that can be staged in async mode
+#ifndef LOGGER_ASYNC_MAX_LINE
+#define LOGGER_ASYNC_MAX_LINE 256
+#endif
+#endif
+
+//If LOGGER_ISR_DEPTH is defined, messages logged from interrupts are formatted into a ring of that many slots
+#ifdef LOGGER_ISR_DEPTH
+#include "LogIsrRing.h"
+
+//Longest single message, including timestamp and indentation, that can be logged from an interrupt
+#ifndef LOGGER_ISR_MAX_LINE
+#define LOGGER_ISR_MAX_LINE 128
+#endif
+#endif
+
+//If LOGGER_STRUCTURED is defined, the logger can send COBS framed binary records instead of text (see SetStructured())
+#ifdef LOGGER_STRUCTURED
+#include "LogRecordFormatter.h"
+#endif
+
+//If LOGGER_RATE_LIMIT_SLOTS is defined, messages can be rate limited per call site using a table of that many buckets,
+//and consecutive repeats from the same call site collapsed (see SetRateLimit() and SetRepeatWindow())
+#ifdef LOGGER_RATE_LIMIT_SLOTS
+#include "LogRateLimiter.h"
+#endif
+
+//If LOGGER_STATS is defined, the logger counts messages, bytes and time spent logging (see GetStats())
+
+//Logging is timed with the Profiler's DWT cycle counter where there is one
+#ifdef LOGGER_STATS
+#include "Profiler.h"
+#ifdef PROFILER_CYCCNT
+#define LOGGER_STATS_CYCCNT
+#endif
+#endif
+
+//Number of modules which can have their own runtime log level
+#ifndef LOGGER_MAX_MODULES
+#define LOGGER_MAX_MODULES 16
+#endif
+
+//Lowest level compiled in by the LOG_xxx() macros. Anything below this is removed entirely, arguments included.
+#ifndef LOGGER_MIN_LEVEL
+#define LOGGER_MIN_LEVEL Logger::LOG_LEVEL_TRACE
+#endif
+
+/**
+	@brief Logs a message if its level is both compiled in and enabled for the module at run time
+
+	Arguments are not evaluated unless the message will actually be printed.
+ */
+#define LOG_AT(log, module, type, ...) \
+	do \
+	{ \
+		if constexpr((type) >= (LOGGER_MIN_LEVEL)) \
+		{ \
+			if((log).IsEnabled(type, module)) \
+				(log).Message(module, type, __VA_ARGS__); \
+		} \
+	} while(0)
+
+#define LOG_TRACE(log, module, ...)		LOG_AT(log, module, Logger::LOG_LEVEL_TRACE, __VA_ARGS__)
+#define LOG_DEBUG(log, module, ...)		LOG_AT(log, module, Logger::LOG_LEVEL_DEBUG, __VA_ARGS__)
+#define LOG_NORMAL(log, module, ...)	LOG_AT(log, module, Logger::NORMAL, __VA_ARGS__)
+#define LOG_WARNING(log, module, ...)	LOG_AT(log, module, Logger::WARNING, __VA_ARGS__)
+#define LOG_ERROR(log, module, ...)		LOG_AT(log, module, Logger::ERROR, __VA_ARGS__)
+
 /**
 	@brief Simple logging framework with uptime timestamps
+
+	Uptime comes from a MonotonicClock, so the timer never needs to be restarted. Each message has a level, and may
+	belong to a module with its own runtime threshold; messages below it are discarded before any formatting is done.
+
+	Optional features, each enabled by the macro shown:
+	  * LOGGER_RATE_LIMIT_SLOTS: per call site rate limiting and repeat collapsing (see LogRateLimiter). Call
+		FlushRepeats() from the idle loop so a storm which has stopped still gets its summary.
+	  * LOGGER_ISR_DEPTH: logging from interrupts, detected automatically on ARM or through FromISR(). Lines go
+		through a LogIsrRing and are sent by DrainISR(), which runs before every thread level message.
+	  * LOGGER_ASYNC_DEPTH: asynchronous mode, where messages are staged in a FIFO and sent by Drain() (see SetAsync())
+	  * LOGGER_STRUCTURED: binary records instead of text (see SetStructured() and LogRecordFormatter)
+	  * LOGGER_STATS: counters for the logger's own load (see GetStats())
+
+	A target which routes output by level or module (such as LogSink) can be given to SetRecordFilter() as well.
  */
 class Logger
 {
@@ -50,43 +142,128 @@ public:
 
 	Logger()
 	: m_target(nullptr)
-	, m_timer(nullptr)
-	, m_timeOffset(0)
-	{}
+	, m_filter(nullptr)
+	, m_indentLevel(0)
+	, m_fracDigits(0)
+	, m_fracScale(1)
+	#ifdef LOGGER_USE_RTC_TIMESTAMP
+	, m_rtcTextValid(false)
+	#endif
+	#ifdef LOGGER_ASYNC_DEPTH
+	, m_async(false)
+	, m_asyncDropped(0)
+	#endif
+	#ifdef LOGGER_STRUCTURED
+	, m_structured(false)
+	#endif
+	#ifdef LOGGER_STATS
+	, m_statsCounter(&m_stats.m_bytes)
+	, m_statsUseCycles(false)
+	#endif
+	{
+		for(uint32_t i=0; i<LOGGER_MAX_MODULES; i++)
+			m_moduleLevel[i] = NORMAL;
+	}
 
 	/**
 		@brief Initializes a logger
 
-		@param target	The UART or other destination for log messages
-		@param timer	Timer with 1ms ticks since reset
+		@param target			The UART or other destination for log messages
+		@param timer			Free running timer. Unlike older versions, the logger never restarts it, and nothing else
+								may restart it or write its count either, or timestamps silently go backwards. Sharing
+								it is fine as long as other users only read it.
+		@param ticksPerSecond	Count rate of the timer
+		@param counterBits		Width of the timer's counter
 	 */
-	void Initialize(CharacterDevice* target, Timer* timer)
+	void Initialize(CharacterDevice* target, Timer* timer, uint32_t ticksPerSecond = 10000, uint32_t counterBits = 32)
 	{
 		m_target = target;
-		m_timer = timer;
+		m_clock.Initialize(timer, ticksPerSecond, counterBits);
+
+		//Print as many fractional digits as the timer resolves, up to microseconds
+		m_fracDigits = 0;
+		m_fracScale = 1;
+		while( (m_fracScale < m_clock.GetTicksPerSecond()) && (m_fracDigits < 6) )
+		{
+			m_fracDigits ++;
+			m_fracScale *= 10;
+		}
+
+		#ifdef LOGGER_STATS
+			m_statsCounter.m_target = target;
+			ResetStats();
+		#endif
 	}
 
+	/**
+		@brief Gets the clock used for timestamps, so other code can share the same timebase
+	 */
+	MonotonicClock& GetClock()
+	{ return m_clock; }
+
+	/**
+		@brief Sets an object to be told the level and module of each message, normally the target itself
+
+		Messages it doesn't want are discarded before any formatting is done. Null to send everything.
+	 */
+	void SetRecordFilter(LogRecordFilter* filter)
+	{
+		m_filter = filter;
+		#ifdef LOGGER_STRUCTURED
+			if(filter)
+				filter->SetStructured(m_structured);
+		#endif
+	}
+
+	/**
+		@brief Message levels, in increasing order of severity
+
+		The two lowest are prefixed because TRACE and DEBUG are common build macros.
+	 */
 	enum LogType
 	{
+		LOG_LEVEL_TRACE,
+		LOG_LEVEL_DEBUG,
 		NORMAL,
 		WARNING,
 		ERROR
 	};
 
+	///@brief Module IDs used within embedded-utils. Applications can use anything from MODULE_USER up.
+	enum LogModule
+	{
+		MODULE_DEFAULT	= 0,
+		MODULE_FLASH	= 1,
+
+		MODULE_USER		= 4
+	};
+
+	/**
+		@brief Checks if messages of a given level will be printed for a given module
+	 */
+	bool IsEnabled(LogType type, uint8_t module = MODULE_DEFAULT)
+	{ return (module < LOGGER_MAX_MODULES) && (type >= m_moduleLevel[module]); }
+
+	/**
+		@brief Sets the lowest level of message which will be printed for a given module
+	 */
+	void SetLevel(LogType type, uint8_t module = MODULE_DEFAULT)
+	{
+		if(module < LOGGER_MAX_MODULES)
+			m_moduleLevel[module] = type;
+	}
+
 	/**
 		@brief Prints a log message
 	 */
 	void operator()(const char* format, ...)
 	{
-		if(!m_target)
+		if(!IsEnabled(NORMAL))
 			return;
 
-		Timestamp(NORMAL);
-		PrintIndent();
-
 		__builtin_va_list list;
 		__builtin_va_start(list, format);
-		m_target->Printf(format, list);
+		Log(NORMAL, MODULE_DEFAULT, format, list);
 		__builtin_va_end(list);
 	}
 
@@ -95,18 +272,187 @@ public:
 	 */
 	void operator()(LogType type, const char* format, ...)
 	{
-		if(!m_target)
+		if(!IsEnabled(type))
 			return;
 
-		Timestamp(type);
-		PrintIndent();
+		__builtin_va_list list;
+		__builtin_va_start(list, format);
+		Log(type, MODULE_DEFAULT, format, list);
+		__builtin_va_end(list);
+	}
+
+	/**
+		@brief Prints a log message on behalf of a module (normally called through the LOG_xxx() macros)
+	 */
+	void Message(uint8_t module, LogType type, const char* format, ...)
+	{
+		if(!IsEnabled(type, module))
+			return;
+
+		__builtin_va_list list;
+		__builtin_va_start(list, format);
+		Log(type, module, format, list);
+		__builtin_va_end(list);
+	}
+
+	#ifdef LOGGER_RATE_LIMIT_SLOTS
+
+	/**
+		@brief Sets the per call site rate limit
+
+		@param perSecond	Sustained messages per second from one call site, or zero to disable rate limiting
+		@param burst		Number of messages which can be printed back to back before the limit kicks in
+	 */
+	void SetRateLimit(uint32_t perSecond, uint32_t burst)
+	{ m_limiter.SetRateLimit(m_clock.GetTicksPerSecond(), perSecond, burst); }
+
+	/**
+		@brief Sets how long repeats of the last message printed are collapsed for, or zero to disable collapsing
+	 */
+	void SetRepeatWindow(uint32_t ms)
+	{ m_limiter.SetRepeatWindow(static_cast<uint64_t>(ms) * m_clock.GetTicksPerSecond() / 1000); }
+
+	void FlushRepeats();
+
+	#endif
+
+	#ifdef LOGGER_STATS
+
+	///@brief Snapshot of the logger's own counters
+	struct Stats
+	{
+		///@brief Messages which passed the level filter, by LogType
+		uint32_t m_messages[ERROR + 1];
+
+		///@brief Bytes of formatted output, including timestamps
+		uint64_t m_bytes;
+
+		///@brief Messages lost to a full async FIFO or interrupt ring
+		uint32_t m_dropped;
+
+		///@brief Messages suppressed by rate limiting or repeat collapsing
+		uint32_t m_suppressed;
+
+		///@brief Total and longest single time spent in logging calls, in units of m_timeRate per second
+		uint64_t m_busyTime;
+		uint32_t m_maxTime;
+		uint32_t m_timeRate;
+
+		///@brief Time since the counters were reset
+		uint64_t m_elapsedUs;
+
+		/**
+			@brief Fraction of the time since the counters were reset which was spent logging, in units of 0.1%
+		 */
+		uint32_t GetLoadPermille() const
+		{
+			if(!m_elapsedUs || !m_timeRate)
+				return 0;
+			uint64_t busyUs = m_busyTime * 1000000 / m_timeRate;
+			return busyUs * 1000 / m_elapsedUs;
+		}
+	};
+
+	/**
+		@brief Gets a snapshot of the counters
+	 */
+	void GetStats(Stats& stats)
+	{
+		stats = m_stats;
+		stats.m_elapsedUs = m_clock.GetMicroseconds() - m_statsStartUs;
+	}
+
+	/**
+		@brief Clears the counters
+
+		@param cpuHz	CPU clock frequency, to time logging with the cycle counter where there is one. Zero to time
+						it with the timestamp clock, which is also used if Profiler::Initialize() finds no counter.
+	 */
+	void ResetStats([[maybe_unused]] uint32_t cpuHz = 0)
+	{
+		m_stats = Stats();
+		m_statsStartUs = m_clock.GetMicroseconds();
+
+		m_statsUseCycles = false;
+		m_stats.m_timeRate = m_clock.GetTicksPerSecond();
+
+		#ifdef LOGGER_STATS_CYCCNT
+			if(cpuHz && Profiler::Initialize(cpuHz))
+			{
+				m_statsUseCycles = true;
+				m_stats.m_timeRate = cpuHz;
+			}
+		#endif
+	}
+
+	#endif
+
+	#ifdef LOGGER_ISR_DEPTH
+
+	/**
+		@brief Logs a message from an interrupt handler
+
+		Only needed where interrupts can't be detected automatically, the normal calls work from handlers on ARM.
+	 */
+	void FromISR(LogType type, const char* format, ...)
+	{
+		if(!IsEnabled(type))
+			return;
 
 		__builtin_va_list list;
 		__builtin_va_start(list, format);
-		m_target->Printf(format, list);
+		Log(type, MODULE_DEFAULT, format, list, true);
 		__builtin_va_end(list);
 	}
 
+	void DrainISR();
+
+	#endif
+
+	#ifdef LOGGER_STRUCTURED
+
+	#ifdef LOGGER_ISR_DEPTH
+	static_assert(
+		LOGGER_ISR_MAX_LINE >= LogRecordFormatter::HEADER_SIZE + 16,
+		"Interrupt slots are too small for a record");
+	#endif
+
+	/**
+		@brief Switches between text and structured binary records
+	 */
+	void SetStructured(bool structured)
+	{
+		m_structured = structured;
+		if(m_filter)
+			m_filter->SetStructured(structured);
+	}
+
+	bool IsStructured()
+	{ return m_structured; }
+
+	#endif
+
+	#ifdef LOGGER_ASYNC_DEPTH
+
+	/**
+		@brief Switches between synchronous and asynchronous mode
+
+		Anything still staged is drained before switching back to synchronous mode, so messages stay in order.
+	 */
+	void SetAsync(bool async)
+	{
+		if(m_async && !async)
+			Drain();
+		m_async = async;
+	}
+
+	bool IsAsync()
+	{ return m_async; }
+
+	void Drain();
+
+	#endif
+
 	/**
 		@brief Increments the log level
 	 */
@@ -122,20 +468,170 @@ public:
 			m_indentLevel --;
 	}
 
-	void UpdateOffset();
-	bool UpdateOffset(uint32_t threshold);
+	/**
+		@brief Periodic hook for timer wrap tracking
+
+		The timestamp clock only notices timer wraps when it's read, and must be read at least once per half wrap
+		period (about 3 seconds for a 16-bit timer at 10 kHz). Logging does that, but a quiet logger doesn't, so call
+		this from the idle loop or a periodic interrupt.
+
+		Older versions restarted the timer here. It's now left running, so applications which restarted the timer
+		themselves to match must stop doing so.
+	 */
+	void UpdateOffset()
+	{ m_clock.GetTicks(); }
+
+	/**
+		@brief Periodic hook for timer wrap tracking, same as UpdateOffset()
+
+		The threshold is ignored since the timer is never restarted.
+
+		@return Always false (the timer was not restarted)
+	 */
+	bool UpdateOffset(uint32_t /*threshold*/)
+	{
+		m_clock.GetTicks();
+		return false;
+	}
 
 protected:
-	void Timestamp();
-	void Timestamp(LogType type);
-	void PrintIndent();
+	void Log(LogType type, uint8_t module, const char* format, __builtin_va_list list, bool fromISR = false);
+	void Dispatch(LogType type, uint8_t module, const char* format, __builtin_va_list list, bool fromISR);
+	void Emit(LogType type, uint8_t module, const char* format, __builtin_va_list list);
+	void EmitRaw(LogType type, uint8_t module, const char* text, uint32_t len);
+	void Notice(LogType type, uint8_t module, const char* format, ...);
+	void Format(
+		CharacterDevice* target,
+		LogType type,
+		const char* format,
+		__builtin_va_list list,
+		bool useCache = true);
+	void Timestamp(CharacterDevice* target, LogType type, bool useCache = true);
+	void PrintIndent(CharacterDevice* target);
+
+	#ifdef LOGGER_USE_RTC_TIMESTAMP
+	void UpdateRtcText(const tm& rtctime);
+	#endif
+
+	#ifdef LOGGER_RATE_LIMIT_SLOTS
+	bool Admit(LogType type, uint8_t module, const char* format);
+	#endif
+
+	#ifdef LOGGER_STATS
+	///@brief Current time for timing logging calls, in units of m_stats.m_timeRate
+	uint32_t GetStatsTime()
+	{
+		#ifdef LOGGER_STATS_CYCCNT
+			if(m_statsUseCycles)
+				return Profiler::GetCycles();
+		#endif
+		return m_clock.GetTicks();
+	}
+
+	/**
+		@brief Passes output through to the target, counting the bytes
+
+		Every call is forwarded to the same method of the target, so turning stats on doesn't change the output of
+		targets with their own text handling. Newlines are counted as two bytes, the same as the preformatted text of
+		the async and interrupt paths.
+	 */
+	class ByteCounter : public CharacterDevice
+	{
+	public:
+		ByteCounter(uint64_t* count)
+		: m_target(nullptr)
+		, m_count(count)
+		{}
+
+		virtual void PrintBinary(char ch) override
+		{
+			(*m_count) ++;
+			m_target->PrintBinary(ch);
+		}
+
+		virtual void Write(const char* data, uint32_t len) override
+		{
+			(*m_count) += len;
+			m_target->Write(data, len);
+		}
+
+		virtual void PrintText(char ch) override
+		{
+			(*m_count) += (ch == '\n') ? 2 : 1;
+			m_target->PrintText(ch);
+		}
+
+		virtual void PrintString(const char* str) override
+		{
+			size_t len = FastStrlen(str);
+			(*m_count) += len;
+			for(auto p = FastMemchr(str, '\n', len); p; p = FastMemchr(p + 1, '\n', str + len - (p + 1)) )
+				(*m_count) ++;
+			m_target->PrintString(str);
+		}
+
+		virtual void Flush() override
+		{ m_target->Flush(); }
+
+		virtual char BlockingRead() override
+		{ return m_target->BlockingRead(); }
+
+		CharacterDevice* m_target;
+
+	protected:
+		uint64_t* m_count;
+	};
+	#endif
+
+	#ifdef LOGGER_ISR_DEPTH
+	void LogFromISR(LogType type, uint8_t module, const char* format, __builtin_va_list list);
+	#endif
 
 protected:
 	CharacterDevice* m_target;
-	Timer* m_timer;
+	LogRecordFilter* m_filter;
+	MonotonicClock m_clock;
 	uint32_t m_indentLevel;
 
-	uint64_t m_timeOffset;
+	///@brief Number of fractional digits in uptime timestamps, and 10^m_fracDigits
+	uint32_t m_fracDigits;
+	uint32_t m_fracScale;
+
+	#ifdef LOGGER_USE_RTC_TIMESTAMP
+	///@brief Rendered "YYYY-MM-DDTHH:MM:SS." for the last message, and the time it was rendered from
+	char m_rtcText[20];
+	bool m_rtcTextValid;
+	tm m_rtcLast;
+	#endif
+
+	#ifdef LOGGER_RATE_LIMIT_SLOTS
+	LogRateLimiter<LOGGER_RATE_LIMIT_SLOTS> m_limiter;
+	#endif
+
+	LogType m_moduleLevel[LOGGER_MAX_MODULES];
+
+	#ifdef LOGGER_ISR_DEPTH
+	LogIsrRing<LOGGER_ISR_DEPTH, LOGGER_ISR_MAX_LINE> m_isr;
+	#endif
+
+	#ifdef LOGGER_ASYNC_DEPTH
+	bool m_async;
+	uint32_t m_asyncDropped;
+
+	///@brief Staged messages, each a header of level, module and 16-bit length followed by the text
+	FIFO<char, LOGGER_ASYNC_DEPTH> m_asyncFifo;
+	#endif
+
+	#ifdef LOGGER_STRUCTURED
+	bool m_structured;
+	#endif
+
+	#ifdef LOGGER_STATS
+	Stats m_stats;
+	ByteCounter m_statsCounter;
+	bool m_statsUseCycles;
+	uint64_t m_statsStartUs;
+	#endif
 };
 
 /**
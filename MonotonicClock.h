@@ -0,0 +1,188 @@
+/***********************************************************************************************************************
+*                                                                                                                      *
+* embedded-utils                                                                                                       *
+*                                                                                                                      *
+* Copyright (c) 2020-2024 Andrew D. Zonenberg                                                                          *
+* All rights reserved.                                                                                                 *
+*                                                                                                                      *
+* Redistribution and use in source and binary forms, with or without modification, are permitted provided that the     *
+* following conditions are met:                                                                                        *
+*                                                                                                                      *
+*    * Redistributions of source code must retain the above copyright notice, this list of conditions, and the         *
+*      following disclaimer.                                                                                           *
+*                                                                                                                      *
+*    * Redistributions in binary form must reproduce the above copyright notice, this list of conditions and the       *
+*      following disclaimer in the documentation and/or other materials provided with the distribution.                *
+*                                                                                                                      *
+*    * Neither the name of the author nor the names of any contributors may be used to endorse or promote products     *
+*      derived from this software without specific prior written permission.                                           *
+*                                                                                                                      *
+* THIS SOFTWARE IS PROVIDED BY THE AUTHORS "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED   *
+* TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL *
+* THE AUTHORS BE HELD LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES        *
+* (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR       *
+* BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT *
+* (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE       *
+* POSSIBILITY OF SUCH DAMAGE.                                                                                          *
+*                                                                                                                      *
+***********************************************************************************************************************/
+
+#ifndef MonotonicClock_h
+#define MonotonicClock_h
+
+#include <stdint.h>
+
+#ifdef SIMULATION
+
+#include <time.h>
+
+class Timer;
+
+/**
+	@brief 64-bit monotonic timebase, host implementation
+
+	Ticks are nanoseconds from CLOCK_MONOTONIC. The timer arguments to Initialize() are ignored, so code using the
+	clock builds unchanged for simulation.
+ */
+class MonotonicClock
+{
+public:
+	void Initialize(Timer* /*timer*/, uint32_t /*ticksPerSecond*/, uint32_t /*counterBits*/ = 32)
+	{}
+
+	uint64_t GetTicks()
+	{
+		timespec t;
+		clock_gettime(CLOCK_MONOTONIC, &t);
+		return static_cast<uint64_t>(t.tv_sec) * 1000000000ULL + t.tv_nsec;
+	}
+
+	uint32_t GetTicksPerSecond()
+	{ return 1000000000; }
+
+	uint64_t GetMicroseconds()
+	{ return GetTicks() / 1000; }
+
+	uint64_t TicksToMicroseconds(uint64_t ticks)
+	{ return ticks / 1000; }
+};
+
+#else
+
+//For now, assume any ARM platform is STM32 and anything else is antikernel-ipcores
+#ifdef __arm__
+#include <peripheral/Timer.h>
+#else
+#include <APB_Timer.h>
+#endif
+
+#ifdef HAVE_TIM
+
+/**
+	@brief 64-bit monotonic timebase extending a free running hardware counter
+
+	The counter is extended without locks or critical sections, so GetTicks() can be called from interrupts as well
+	as the main loop. It uses the same scheme as Linux cnt32_to_63(): the top bit of the stored high word mirrors the
+	top bit of the counter, and whichever caller first sees them disagree bumps the high word. Concurrent callers
+	compute the same new value, so a preempted update is harmless.
+
+	The only requirement is that GetTicks() is called at least once per half wrap period of the counter, e.g. every
+	3 seconds for a 16-bit counter or every 2.5 days for a 32-bit one at 10 kHz. Logging usually takes care of this;
+	otherwise call it from the idle loop or a periodic interrupt. The timer must never be restarted.
+
+	Counters narrower than 32 bits are shifted up to 32 bits before extension, so the usable range is 63 bits of the
+	counter's own ticks either way.
+ */
+class MonotonicClock
+{
+public:
+	MonotonicClock()
+	: m_timer(nullptr)
+	, m_shift(0)
+	, m_high(0)
+	, m_ticksPerSecond(1)
+	, m_usPerTick(0)
+	, m_ticksPerUs(0)
+	{}
+
+	/**
+		@brief Initializes the clock
+
+		@param timer			Free running timer
+		@param ticksPerSecond	Count rate of the timer
+		@param counterBits		Width of the counter (at most 32)
+	 */
+	void Initialize(Timer* timer, uint32_t ticksPerSecond, uint32_t counterBits = 32)
+	{
+		m_timer = timer;
+		m_shift = 32 - counterBits;
+		m_high = 0;
+		m_ticksPerSecond = ticksPerSecond;
+
+		//Precompute the cheapest conversion to microseconds for common rates
+		m_usPerTick = 0;
+		m_ticksPerUs = 0;
+		if( (1000000 % ticksPerSecond) == 0)
+			m_usPerTick = 1000000 / ticksPerSecond;
+		else if( (ticksPerSecond % 1000000) == 0)
+			m_ticksPerUs = ticksPerSecond / 1000000;
+	}
+
+	/**
+		@brief Gets the number of timer ticks since the timer was started
+	 */
+	uint64_t GetTicks()
+	{
+		//High word must be read before the counter
+		uint32_t hi = m_high;
+		asm volatile("" ::: "memory");
+		uint32_t lo = m_timer->GetCount() << m_shift;
+
+		if(static_cast<int32_t>(hi ^ lo) < 0)
+		{
+			hi = (hi ^ 0x80000000) + (hi >> 31);
+			m_high = hi;
+		}
+
+		uint64_t ticks = (static_cast<uint64_t>(hi & 0x7fffffff) << 32) | lo;
+		return ticks >> m_shift;
+	}
+
+	uint32_t GetTicksPerSecond()
+	{ return m_ticksPerSecond; }
+
+	/**
+		@brief Gets the number of microseconds since the timer was started
+	 */
+	uint64_t GetMicroseconds()
+	{ return TicksToMicroseconds(GetTicks()); }
+
+	/**
+		@brief Converts a tick count (or difference between two) to microseconds
+	 */
+	uint64_t TicksToMicroseconds(uint64_t ticks)
+	{
+		if(m_usPerTick)
+			return ticks * m_usPerTick;
+		if(m_ticksPerUs)
+			return ticks / m_ticksPerUs;
+		return (ticks / m_ticksPerSecond) * 1000000 + (ticks % m_ticksPerSecond) * 1000000 / m_ticksPerSecond;
+	}
+
+protected:
+	Timer* m_timer;
+	uint32_t m_shift;
+
+	///@brief Extension word: wrap count in bits 30:0, last seen counter MSB in bit 31
+	volatile uint32_t m_high;
+
+	uint32_t m_ticksPerSecond;
+	uint32_t m_usPerTick;
+	uint32_t m_ticksPerUs;
+};
+
+#endif
+
+#endif
+
+#endif
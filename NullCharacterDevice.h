@@ -0,0 +1,70 @@
+/***********************************************************************************************************************
+*                                                                                                                      *
+* embedded-utils                                                                                                       *
+*                                                                                                                      *
+* Copyright (c) 2020-2025 Andrew D. Zonenberg                                                                          *
+* All rights reserved.                                                                                                 *
+*                                                                                                                      *
+* Redistribution and use in source and binary forms, with or without modification, are permitted provided that the     *
+* following conditions are met:                                                                                        *
+*                                                                                                                      *
+*    * Redistributions of source code must retain the above copyright notice, this list of conditions, and the         *
+*      following disclaimer.                                                                                           *
+*                                                                                                                      *
+*    * Redistributions in binary form must reproduce the above copyright notice, this list of conditions and the       *
+*      following disclaimer in the documentation and/or other materials provided with the distribution.                *
+*                                                                                                                      *
+*    * Neither the name of the author nor the names of any contributors may be used to endorse or promote products     *
+*      derived from this software without specific prior written permission.                                           *
+*                                                                                                                      *
+* THIS SOFTWARE IS PROVIDED BY THE AUTHORS "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED   *
+* TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL *
+* THE AUTHORS BE HELD LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES        *
+* (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR       *
+* BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT *
+* (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE       *
+* POSSIBILITY OF SUCH DAMAGE.                                                                                          *
+*                                                                                                                      *
+***********************************************************************************************************************/
+
+#ifndef NullCharacterDevice_h
+#define NullCharacterDevice_h
+
+#include "CharacterDevice.h"
+
+/**
+	@brief A character device that discards everything written to it, but counts the bytes
+
+	Useful for finding out how long a formatted string will be before committing buffer space to it, or for timing
+	formatting code without the cost of a real output device.
+ */
+class NullCharacterDevice : public CharacterDevice
+{
+public:
+	NullCharacterDevice()
+	: m_count(0)
+	{}
+
+	virtual void PrintBinary([[maybe_unused]] char ch) override
+	{ m_count ++; }
+
+	virtual void Write([[maybe_unused]] const char* data, uint32_t len) override
+	{ m_count += len; }
+
+	///@brief not used, but has to be defined because base class needs it
+	virtual char BlockingRead() override
+	{ return 0; }
+
+	///@brief Number of bytes written since creation or the last Clear()
+	size_t length()
+	{ return m_count; }
+
+	///@brief Resets the byte count
+	void Clear()
+	{ m_count = 0; }
+
+protected:
+	size_t m_count;
+};
+
+#endif
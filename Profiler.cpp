@@ -0,0 +1,148 @@
+/***********************************************************************************************************************
+*                                                                                                                      *
+* embedded-utils                                                                                                       *
+*                                                                                                                      *
+* Copyright (c) 2020-2025 Andrew D. Zonenberg                                                                          *
+* All rights reserved.                                                                                                 *
+*                                                                                                                      *
+* Redistribution and use in source and binary forms, with or without modification, are permitted provided that the     *
+* following conditions are met:                                                                                        *
+*                                                                                                                      *
+*    * Redistributions of source code must retain the above copyright notice, this list of conditions, and the         *
+*      following disclaimer.                                                                                           *
+*                                                                                                                      *
+*    * Redistributions in binary form must reproduce the above copyright notice, this list of conditions and the       *
+*      following disclaimer in the documentation and/or other materials provided with the distribution.                *
+*                                                                                                                      *
+*    * Neither the name of the author nor the names of any contributors may be used to endorse or promote products     *
+*      derived from this software without specific prior written permission.                                           *
+*                                                                                                                      *
+* THIS SOFTWARE IS PROVIDED BY THE AUTHORS "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED   *
+* TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL *
+* THE AUTHORS BE HELD LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES        *
+* (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR       *
+* BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT *
+* (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE       *
+* POSSIBILITY OF SUCH DAMAGE.                                                                                          *
+*                                                                                                                      *
+***********************************************************************************************************************/
+
+#include <stdint.h>
+#include "Logger.h"
+#include "Profiler.h"
+
+#ifdef PROFILER_CYCCNT
+#include "CoreSightRom.h"
+#endif
+
+//Rate of the cycle counter, or zero if there isn't one or its rate is unknown
+static uint32_t g_profileRate = 0;
+
+/**
+	@brief Starts the cycle counter
+
+	Safe to call more than once, e.g. from both the application and Logger::ResetStats().
+
+	@param cpuHz	CPU clock frequency, or zero if unknown. Ignored under SIMULATION, where the counter rate is
+					measured instead.
+
+	@return True if there's a working cycle counter, even if its rate isn't known
+ */
+bool Profiler::Initialize([[maybe_unused]] uint32_t cpuHz)
+{
+	g_profileRate = 0;
+
+	#if defined(PROFILER_CYCCNT)
+
+		//The DWT is only visible with trace enabled (DEMCR.TRCENA)
+		Reg(DEMCR) |= (1 << 24);
+		if(!FindRomComponent(DWT_BASE))
+			return false;
+
+		//DWT_CTRL.NOCYCCNT
+		if(Reg(DWT_CTRL) & (1 << 25))
+			return false;
+
+		//Unlock the DWT where there's a lock, and start the counter
+		Reg(DWT_LAR) = 0xc5acce55;
+		Reg(DWT_CTRL) |= 1;
+		g_profileRate = cpuHz;
+		return true;
+
+	#elif defined(SIMULATION) && (defined(__x86_64__) || defined(__i386__))
+
+		//Measure the TSC against the monotonic clock over 10 ms
+		timespec start;
+		timespec now;
+		clock_gettime(CLOCK_MONOTONIC, &start);
+		uint32_t cstart = GetCycles();
+		uint64_t ns;
+		do
+		{
+			clock_gettime(CLOCK_MONOTONIC, &now);
+			ns = (now.tv_sec - start.tv_sec) * 1000000000ULL + now.tv_nsec - start.tv_nsec;
+		} while(ns < 10000000);
+		g_profileRate = static_cast<uint64_t>(GetCycles() - cstart) * 1000000000ULL / ns;
+
+	#elif defined(SIMULATION)
+		g_profileRate = 1000000000;
+	#endif
+
+	return g_profileRate != 0;
+}
+
+uint32_t Profiler::GetRate()
+{
+	return g_profileRate;
+}
+
+#ifdef HAVE_TIM
+
+/**
+	@brief Prints the statistics and the nonempty histogram buckets
+
+	The mean is also shown in microseconds if the counter rate is known.
+ */
+void ProfileSlot::Print(Logger& log)
+{
+	uint32_t rate = Profiler::GetRate();
+	if(rate)
+	{
+		uint32_t meanNs = static_cast<uint64_t>(GetMean()) * 1000000000ULL / rate;
+		log("%s: %u calls, min %u / mean %u / max %u cycles (mean %u.%03u us)\n",
+			m_name, m_count, GetMin(), GetMean(), m_max, meanNs / 1000, meanNs % 1000);
+	}
+	else
+		log("%s: %u calls, min %u / mean %u / max %u cycles\n", m_name, m_count, GetMin(), GetMean(), m_max);
+	if(!m_count)
+		return;
+
+	LogIndenter li(log);
+
+	uint32_t biggest = 0;
+	for(uint32_t i=0; i<32; i++)
+	{
+		if(m_buckets[i] > biggest)
+			biggest = m_buckets[i];
+	}
+
+	for(uint32_t i=0; i<32; i++)
+	{
+		if(!m_buckets[i])
+			continue;
+
+		//Bar scaled to the biggest bucket, at least one character so nothing is invisible
+		char bar[33];
+		uint32_t len = static_cast<uint64_t>(m_buckets[i]) * 32 / biggest;
+		if(len == 0)
+			len = 1;
+		for(uint32_t j=0; j<len; j++)
+			bar[j] = '#';
+		bar[len] = '\0';
+
+		uint32_t lo = i ? (1u << i) : 0;
+		log("%10u - %10u: %8u %s\n", lo, (i == 31) ? 0xffffffff : ( (1u << (i+1)) - 1), m_buckets[i], bar);
+	}
+}
+
+#endif
@@ -0,0 +1,174 @@
+/***********************************************************************************************************************
+*                                                                                                                      *
+* embedded-utils                                                                                                       *
+*                                                                                                                      *
+* Copyright (c) 2020-2025 Andrew D. Zonenberg                                                                          *
+* All rights reserved.                                                                                                 *
+*                                                                                                                      *
+* Redistribution and use in source and binary forms, with or without modification, are permitted provided that the     *
+* following conditions are met:                                                                                        *
+*                                                                                                                      *
+*    * Redistributions of source code must retain the above copyright notice, this list of conditions, and the         *
+*      following disclaimer.                                                                                           *
+*                                                                                                                      *
+*    * Redistributions in binary form must reproduce the above copyright notice, this list of conditions and the       *
+*      following disclaimer in the documentation and/or other materials provided with the distribution.                *
+*                                                                                                                      *
+*    * Neither the name of the author nor the names of any contributors may be used to endorse or promote products     *
+*      derived from this software without specific prior written permission.                                           *
+*                                                                                                                      *
+* THIS SOFTWARE IS PROVIDED BY THE AUTHORS "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED   *
+* TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL *
+* THE AUTHORS BE HELD LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES        *
+* (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR       *
+* BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT *
+* (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE       *
+* POSSIBILITY OF SUCH DAMAGE.                                                                                          *
+*                                                                                                                      *
+***********************************************************************************************************************/
+
+#ifndef Profiler_h
+#define Profiler_h
+
+#include <stdint.h>
+
+#ifdef SIMULATION
+#include <time.h>
+#endif
+
+//ARMv7-M and ARMv8-M mainline have a DWT cycle counter
+#if !defined(SIMULATION) && (defined(__ARM_ARCH_7M__) || defined(__ARM_ARCH_7EM__) || defined(__ARM_ARCH_8M_MAIN__))
+#define PROFILER_CYCCNT
+#endif
+
+class Logger;
+
+/**
+	@brief Cycle counter for profiling
+
+	On ARMv7-M and ARMv8-M mainline this is the DWT cycle counter, which Initialize() only enables after finding the
+	DWT in the CoreSight ROM tables and checking it has a cycle counter. Under SIMULATION it's the TSC on x86, or
+	CLOCK_MONOTONIC in nanoseconds elsewhere, so the same instrumentation works in host benchmarks. Anywhere else there
+	is no counter, and everything reads as zero cycles.
+ */
+class Profiler
+{
+public:
+	static bool Initialize(uint32_t cpuHz);
+
+	///@brief Counter rate in Hz, or zero if there's no counter or the rate isn't known
+	static uint32_t GetRate();
+
+	///@brief Reads the counter, which wraps at 32 bits
+	static uint32_t GetCycles()
+	{
+		#if defined(PROFILER_CYCCNT)
+			return Reg(DWT_CYCCNT);
+		#elif defined(SIMULATION) && (defined(__x86_64__) || defined(__i386__))
+			return __builtin_ia32_rdtsc();
+		#elif defined(SIMULATION)
+			timespec t;
+			clock_gettime(CLOCK_MONOTONIC, &t);
+			return static_cast<uint64_t>(t.tv_sec) * 1000000000ULL + t.tv_nsec;
+		#else
+			return 0;
+		#endif
+	}
+
+	#ifdef PROFILER_CYCCNT
+protected:
+	//Debug registers used to find and start the cycle counter (ARMv7-M ARM C1.6, C1.8)
+	static const uintptr_t DEMCR = 0xe000edfc;
+	static const uintptr_t DWT_BASE = 0xe0001000;
+	static const uintptr_t DWT_CTRL = DWT_BASE + 0x000;
+	static const uintptr_t DWT_CYCCNT = DWT_BASE + 0x004;
+	static const uintptr_t DWT_LAR = DWT_BASE + 0xfb0;
+
+	static volatile uint32_t& Reg(uintptr_t addr)
+	{ return *reinterpret_cast<volatile uint32_t*>(addr); }
+	#endif
+};
+
+/**
+	@brief Timing statistics for one piece of code: count, min, max, mean and a histogram with power of two buckets
+
+	Updates aren't interlocked, so a slot should only be timed at one interrupt priority.
+ */
+class ProfileSlot
+{
+public:
+	ProfileSlot(const char* name)
+	: m_name(name)
+	{ Reset(); }
+
+	void Reset()
+	{
+		m_count = 0;
+		m_min = 0xffffffff;
+		m_max = 0;
+		m_total = 0;
+		for(uint32_t i=0; i<32; i++)
+			m_buckets[i] = 0;
+	}
+
+	///@brief Adds one measurement, in cycles
+	void Add(uint32_t cycles)
+	{
+		m_count ++;
+		m_total += cycles;
+		if(cycles < m_min)
+			m_min = cycles;
+		if(cycles > m_max)
+			m_max = cycles;
+
+		//Bucket N holds [2^N, 2^(N+1)), zero goes in bucket 0
+		m_buckets[cycles ? (31 - __builtin_clz(cycles)) : 0] ++;
+	}
+
+	uint32_t GetCount()
+	{ return m_count; }
+
+	uint32_t GetMin()
+	{ return m_count ? m_min : 0; }
+
+	uint32_t GetMax()
+	{ return m_max; }
+
+	uint32_t GetMean()
+	{ return m_count ? (m_total / m_count) : 0; }
+
+	uint32_t GetBucket(uint32_t i)
+	{ return m_buckets[i]; }
+
+	///@brief Only available where there's a Logger (HAVE_TIM)
+	void Print(Logger& log);
+
+protected:
+	const char* m_name;
+	uint32_t m_count;
+	uint32_t m_min;
+	uint32_t m_max;
+	uint64_t m_total;
+	uint32_t m_buckets[32];
+};
+
+/**
+	@brief Times the enclosing scope into a ProfileSlot
+ */
+class ProfileScope
+{
+public:
+	ProfileScope(ProfileSlot& slot)
+	: m_slot(slot)
+	, m_start(Profiler::GetCycles())
+	{}
+
+	~ProfileScope()
+	{ m_slot.Add(Profiler::GetCycles() - m_start); }
+
+protected:
+	ProfileSlot& m_slot;
+	uint32_t m_start;
+};
+
+#endif
@@ -220,7 +220,7 @@ void SpiFlashInterfaceBase::ReadSFDP()
 		uint8_t nwords = sfdp[base+3];
 		uint8_t major = sfdp[base+2];
 		uint8_t minor = sfdp[base+1];
-		g_log("Parameter %d: ID %04x, rev %d.%d, length %d words, offset %08x\n",
+		LOG_DEBUG(g_log, Logger::MODULE_FLASH, "Parameter %d: ID %04x, rev %d.%d, length %d words, offset %08x\n",
 			i,
 			id,
 			major, minor,
@@ -264,19 +264,19 @@ void SpiFlashInterfaceBase::ReadSFDPParameter_JEDEC(
 	switch( (param[0] >> 17) & 3)
 	{
 		case 0:
-			g_log("3-byte addressing\n");
+			LOG_DEBUG(g_log, Logger::MODULE_FLASH, "3-byte addressing\n");
 			m_fastReadInstruction = 0x0b;
 			m_addressLength = ADDR_3BYTE;
 			break;
 
 		case 1:
-			g_log("3/4 byte switchable addressing\n");
+			LOG_DEBUG(g_log, Logger::MODULE_FLASH, "3/4 byte switchable addressing\n");
 			m_fastReadInstruction = 0x0b;
 			m_addressLength = ADDR_3BYTE;
 			break;
 
 		case 2:
-			g_log("4-byte addressing\n");
+			LOG_DEBUG(g_log, Logger::MODULE_FLASH, "4-byte addressing\n");
 			m_fastReadInstruction = 0x0c;
 			m_addressLength = ADDR_4BYTE;
 			break;
@@ -294,7 +294,7 @@ void SpiFlashInterfaceBase::ReadSFDPParameter_JEDEC(
 
 			uint8_t op = (param[2] >> 8) & 0xff;
 			uint8_t dummy = param[2] & 0x1f;
-			g_log("1-4-4 fast read supported, opcode %02x, %d dummy clocks\n", op, dummy);
+			LOG_DEBUG(g_log, Logger::MODULE_FLASH, "1-4-4 fast read supported, opcode %02x, %d dummy clocks\n", op, dummy);
 		}
 
 		//for now we only support 1-1-4 read
@@ -303,7 +303,7 @@ void SpiFlashInterfaceBase::ReadSFDPParameter_JEDEC(
 			m_quadReadAvailable = true;
 			m_quadReadInstruction = (param[2] >> 24) & 0xff;
 			m_quadReadDummyClocks = (param[2] >> 16) & 0x1f;
-			g_log("1-1-4 fast read supported, opcode %02x, %d dummy clocks\n", m_quadReadInstruction, m_quadReadDummyClocks);
+			LOG_DEBUG(g_log, Logger::MODULE_FLASH, "1-1-4 fast read supported, opcode %02x, %d dummy clocks\n", m_quadReadInstruction, m_quadReadDummyClocks);
 
 			//WORKAROUND: if this is an ISSI flash chip, it will probably claim to only have 3 byte addressing
 			//even if it's >128 Mbits. Use 4FRQO 0x6c
@@ -321,9 +321,9 @@ void SpiFlashInterfaceBase::ReadSFDPParameter_JEDEC(
 
 	uint8_t eraseOpcode = (param[0] >> 8) & 0xff;
 	if(eraseOpcode == 0xff)
-		g_log("4 kB erase not available\n");
+		LOG_DEBUG(g_log, Logger::MODULE_FLASH, "4 kB erase not available\n");
 	else
-		g_log("4 kB erase opcode: %02x\n", eraseOpcode);
+		LOG_DEBUG(g_log, Logger::MODULE_FLASH, "4 kB erase opcode: %02x\n", eraseOpcode);
 
 	uint8_t param4logsize = (param[8] >> 16) & 0xff;
 	uint8_t param4op = (param[8] >> 24) & 0xff;
@@ -332,7 +332,7 @@ void SpiFlashInterfaceBase::ReadSFDPParameter_JEDEC(
 		uint32_t param4SizeBytes = (1 << param4logsize);
 		uint32_t param4SizeKbytes = param4SizeBytes / 1024;
 		uint32_t param4EraseTimeMs = GetEraseTime(param[9] >> 25);
-		g_log("Type 4 sector erase: op=%02x, size=%d kB, typical %d ms\n", param4op, param4SizeKbytes, param4EraseTimeMs);
+		LOG_DEBUG(g_log, Logger::MODULE_FLASH, "Type 4 sector erase: op=%02x, size=%d kB, typical %d ms\n", param4op, param4SizeKbytes, param4EraseTimeMs);
 
 		//TODO: support multiple sector sizes
 		//For now just use the highest numbered (normally largest) one we support
@@ -347,7 +347,7 @@ void SpiFlashInterfaceBase::ReadSFDPParameter_JEDEC(
 		uint32_t param3SizeBytes = (1 << param3logsize);
 		uint32_t param3SizeKbytes = param3SizeBytes / 1024;
 		uint32_t param3EraseTimeMs = GetEraseTime(param[9] >> 18);
-		g_log("Type 3 sector erase: op=%02x, size=%d kB, typical %d ms\n", param3op, param3SizeKbytes, param3EraseTimeMs);
+		LOG_DEBUG(g_log, Logger::MODULE_FLASH, "Type 3 sector erase: op=%02x, size=%d kB, typical %d ms\n", param3op, param3SizeKbytes, param3EraseTimeMs);
 
 		//TODO: support multiple sector sizes
 		//For now just use the highest numbered (normally largest) one we support
@@ -365,7 +365,7 @@ void SpiFlashInterfaceBase::ReadSFDPParameter_JEDEC(
 		uint32_t param2SizeBytes = (1 << param2logsize);
 		uint32_t param2SizeKbytes = param2SizeBytes / 1024;
 		uint32_t param2EraseTimeMs = GetEraseTime(param[9] >> 11);
-		g_log("Type 2 sector erase: op=%02x, size=%d kB, typical %d ms\n", param2op, param2SizeKbytes, param2EraseTimeMs);
+		LOG_DEBUG(g_log, Logger::MODULE_FLASH, "Type 2 sector erase: op=%02x, size=%d kB, typical %d ms\n", param2op, param2SizeKbytes, param2EraseTimeMs);
 
 		//TODO: support multiple sector sizes
 		//For now just use the highest numbered (normally largest) one we support
@@ -383,7 +383,7 @@ void SpiFlashInterfaceBase::ReadSFDPParameter_JEDEC(
 		uint32_t param1SizeBytes = (1 << param1logsize);
 		uint32_t param1SizeKbytes = param1SizeBytes / 1024;
 		uint32_t param1EraseTimeMs = GetEraseTime(param[9] >> 4);
-		g_log("Type 1 sector erase: op=%02x, size=%d kB, typical %d ms\n", param1op, param1SizeKbytes, param1EraseTimeMs);
+		LOG_DEBUG(g_log, Logger::MODULE_FLASH, "Type 1 sector erase: op=%02x, size=%d kB, typical %d ms\n", param1op, param1SizeKbytes, param1EraseTimeMs);
 
 		//TODO: support multiple sector sizes
 		//For now just use the highest numbered (normally largest) one we support
@@ -419,10 +419,10 @@ void SpiFlashInterfaceBase::ReadSFDPParameter_JEDEC(
 				maxEraseTime *= 64000;
 				break;
 		}
-		g_log("Full chip erase time: typical %d ms\n", maxEraseTime);
+		LOG_DEBUG(g_log, Logger::MODULE_FLASH, "Full chip erase time: typical %d ms\n", maxEraseTime);
 
 		uint32_t maxEraseScale = ((param[9] & 0xf) + 1) * 2;
-		g_log("Worst case erase time is %d times typical\n", maxEraseScale);
+		LOG_DEBUG(g_log, Logger::MODULE_FLASH, "Worst case erase time is %d times typical\n", maxEraseScale);
 
 		uint32_t pagelog = (param[10] >> 4) & 0xf;
 		m_maxWriteBlock = 1 << (pagelog);
@@ -38,6 +38,12 @@
 
 /**
 	@brief Helper for formatting strings
+
+	Output past the end of the buffer is discarded, but still counted, so callers can detect truncation and find out
+	how big the buffer would have needed to be.
+
+	Unlike older versions, the buffer is only null terminated when c_str() is called, not after every character. Code
+	reading the underlying array must either call c_str() first or stop at length().
  */
 class StringBuffer : public CharacterDevice
 {
@@ -46,39 +52,68 @@ public:
 	: m_buf(buf)
 	, m_size(size)
 	, m_wptr(0)
+	, m_wanted(0)
 	{
 	}
 
 	virtual void PrintBinary(char ch) override
 	{
-		if(m_wptr < m_size)
+		//Always leave room for the terminator
+		if(m_wptr + 1 < m_size)
 			m_buf[m_wptr ++] = ch;
+		m_wanted ++;
+	}
 
-		//Null terminate
-		if(m_wptr < m_size)
-			m_buf[m_wptr] = '\0';
-		else
-			m_buf[m_size-1] = '\0';
+	virtual void Write(const char* data, uint32_t len) override
+	{
+		size_t space = (m_size > m_wptr) ? (m_size - m_wptr - 1) : 0;
+		size_t n = (len < space) ? len : space;
+		memcpy(m_buf + m_wptr, data, n);
+		m_wptr += n;
+		m_wanted += len;
 	}
 
+	virtual void PrintString(const char* str) override
+	{ PrintStringByRuns(str); }
+
 	///@brief not used, but has to be defined because base class needs it
 	virtual char BlockingRead() override
 	{ return 0; }
 
+	///@brief Null terminates the buffer and returns it
+	const char* c_str()
+	{
+		if(m_size)
+			m_buf[m_wptr] = '\0';
+		return m_buf;
+	}
+
+	///@brief Number of characters actually stored in the buffer
 	size_t length()
 	{ return m_wptr; }
 
+	///@brief Number of characters that were written, including any that didn't fit
+	size_t WantedLength()
+	{ return m_wanted; }
+
+	///@brief True if anything was discarded because the buffer was full
+	bool Overflowed()
+	{ return m_wanted > m_wptr; }
+
 	///@brief Resets the buffer to an empty state
 	void Clear()
 	{
 		m_wptr = 0;
-		memset(m_buf, 0, m_size);
+		m_wanted = 0;
+		if(m_size)
+			m_buf[0] = '\0';
 	}
 
 protected:
 	char* m_buf;
 	size_t m_size;
 	size_t m_wptr;
+	size_t m_wanted;
 };
 
 #endif
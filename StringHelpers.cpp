@@ -33,6 +33,19 @@
 #include "StringHelpers.h"
 #include "CharacterDevice.h"
 
+static const char g_hexLower[] = "0123456789abcdef";
+static const char g_hexUpper[] = "0123456789ABCDEF";
+
+/**
+	@brief Returns the number of significant hex digits in a value (one for zero)
+ */
+static int HexDigitCount(uint64_t n)
+{
+	if(n == 0)
+		return 1;
+	return (67 - __builtin_clzll(n)) / 4;
+}
+
 /**
 	@brief Reverses a string in-place (K&R implementation)
 
@@ -54,7 +67,7 @@ char* reverse(char* s)
 }
 
 /**
-	@brief Converts an int to a string (K&R implementation)
+	@brief Converts an int to a string
 
 	@param n Input
 	@param s String to store into (must be 12+ bytes long to hold any possible integer)
@@ -63,46 +76,520 @@ char* reverse(char* s)
  */
 char* itoa(int n, char* s)
 {
-	int i, sign;
+	if(n >= 0)
+		return utoa(n, s);
+
+	//Negate as unsigned so INT_MIN doesn't overflow
+	s[0] = '-';
+	utoa(-static_cast<unsigned int>(n), s+1);
+	return s;
+}
+
+/**
+	@brief Converts an int to a string (K&R implementation but uisugned)
+
+	@param n Input
+	@param s String to store into (must be 12+ bytes long to hold any possible integer)
+
+	@return str
+ */
+char* utoa(unsigned int n, char* s)
+{
+	unsigned int i;
 
-	if ((sign = n) < 0)  /* record sign */
-		n = -n;          /* make n positive */
 	i = 0;
 	do
 	{       /* generate digits in reverse order */
 		s[i++] = n % 10 + '0';   /* get next digit */
 	} while ((n /= 10) > 0);     /* delete it */
 
-	if (sign < 0)
-		s[i++] = '-';
 	s[i] = '\0';
 
 	return reverse(s);
 }
 
 /**
-	@brief Converts an int to a string (K&R implementation but uisugned)
+	@brief Converts a 64-bit unsigned int to a string
 
 	@param n Input
-	@param s String to store into (must be 12+ bytes long to hold any possible integer)
+	@param s String to store into (must be 21+ bytes long to hold any possible integer)
 
 	@return str
  */
-char* utoa(unsigned int n, char* s)
+char* ulltoa(uint64_t n, char* s)
 {
-	unsigned int i;
+	//Use native 32-bit division when we can, since 64-bit division is a libgcc call on most of our targets
+	if(n <= 0xffffffff)
+		return utoa(n, s);
 
-	i = 0;
+	unsigned int i = 0;
 	do
-	{       /* generate digits in reverse order */
-		s[i++] = n % 10 + '0';   /* get next digit */
-	} while ((n /= 10) > 0);     /* delete it */
+	{
+		s[i++] = n % 10 + '0';
+	} while ((n /= 10) > 0);
 
 	s[i] = '\0';
 
 	return reverse(s);
 }
 
+/**
+	@brief Converts a 64-bit signed int to a string
+
+	@param n Input
+	@param s String to store into (must be 21+ bytes long to hold any possible integer)
+
+	@return str
+ */
+char* lltoa(int64_t n, char* s)
+{
+	if(n >= 0)
+		return ulltoa(n, s);
+
+	//Negate as unsigned so INT64_MIN doesn't overflow
+	s[0] = '-';
+	ulltoa(-static_cast<uint64_t>(n), s+1);
+	return s;
+}
+
+/**
+	@brief Converts an unsigned int to a fixed number of hex digits, including leading zeros
+
+	The output is not null terminated.
+
+	@param s		String to store into (must be at least ndigits bytes long)
+	@param n		Input
+	@param ndigits	Number of digits to write (1-16)
+	@param upper	True for uppercase A-F
+
+	@return Pointer to one past the last digit written
+ */
+char* FormatHex(char* s, uint64_t n, int ndigits, bool upper)
+{
+	const char* table = upper ? g_hexUpper : g_hexLower;
+	for(int i=ndigits-1; i>=0; i--)
+	{
+		s[i] = table[n & 0xf];
+		n >>= 4;
+	}
+	return s + ndigits;
+}
+
+/**
+	@brief Converts an integer to exactly ndigits decimal digits, including leading zeros, and null terminates it
+ */
+static void FormatDecimalDigits(char* s, uint64_t n, int ndigits)
+{
+	for(int i=ndigits-1; i>=0; i--)
+	{
+		s[i] = '0' + (n % 10);
+		n /= 10;
+	}
+	s[ndigits] = '\0';
+}
+
+/**
+	@brief Converts a fixed point value to a decimal string, rounding to nearest
+
+	@param s			String to store into (must be 23 + precision bytes long)
+	@param mag			Magnitude of the value
+	@param fracbits		Number of fractional bits in mag (up to 32)
+	@param negative		True to print a leading minus sign
+	@param precision	Number of digits after the decimal point (up to 32). If zero, the decimal point is omitted.
+
+	@return str
+ */
+char* FormatFixed(char* s, uint64_t mag, int fracbits, bool negative, int precision)
+{
+	uint64_t ipart = mag >> fracbits;
+	uint64_t mask = (uint64_t(1) << fracbits) - 1;
+	uint64_t frac = mag & mask;
+
+	//Generate fractional digits by repeated multiplication.
+	//frac is at most 32 bits, so frac*10 always fits in 64.
+	char* p = s;
+	if(negative)
+		*(p++) = '-';
+	char digits[32];
+	if(precision > 32)
+		precision = 32;
+	for(int i=0; i<precision; i++)
+	{
+		frac *= 10;
+		digits[i] = '0' + (frac >> fracbits);
+		frac &= mask;
+	}
+
+	//Round to nearest (ties to even, same as glibc) using whatever is left, carrying into the integer part if needed
+	bool roundUp = false;
+	if(fracbits > 0)
+	{
+		uint64_t half = uint64_t(1) << (fracbits - 1);
+		if(frac > half)
+			roundUp = true;
+		else if(frac == half)
+		{
+			if(precision > 0)
+				roundUp = (digits[precision-1] - '0') & 1;
+			else
+				roundUp = ipart & 1;
+		}
+	}
+	if(roundUp)
+	{
+		int i = precision - 1;
+		for(; i >= 0; i--)
+		{
+			if(digits[i] == '9')
+				digits[i] = '0';
+			else
+			{
+				digits[i] ++;
+				break;
+			}
+		}
+		if(i < 0)
+			ipart ++;
+	}
+
+	ulltoa(ipart, p);
+	if(precision > 0)
+	{
+		p += strlen(p);
+		*(p++) = '.';
+		memcpy(p, digits, precision);
+		p[precision] = '\0';
+	}
+
+	return s;
+}
+
+/**
+	@brief Minimal fixed-capacity unsigned big integer for exact binary to decimal conversion of doubles
+
+	Large enough for any double scaled by up to 10^17 in either direction, which is the worst case FormatFloat needs.
+	Tracks whether any nonzero bits have been discarded by a division or right shift, so the final result can be
+	correctly rounded.
+ */
+class FloatBigInt
+{
+public:
+	FloatBigInt(uint64_t n)
+	: m_len(0)
+	, m_sticky(false)
+	{
+		while(n)
+		{
+			m_words[m_len++] = n;
+			n >>= 32;
+		}
+	}
+
+	void MulSmall(uint32_t x)
+	{
+		uint32_t carry = 0;
+		for(int i=0; i<m_len; i++)
+		{
+			uint64_t t = static_cast<uint64_t>(m_words[i]) * x + carry;
+			m_words[i] = t;
+			carry = t >> 32;
+		}
+		if(carry)
+			m_words[m_len++] = carry;
+	}
+
+	void DivSmall(uint32_t x)
+	{
+		uint64_t rem = 0;
+		for(int i=m_len-1; i>=0; i--)
+		{
+			uint64_t t = (rem << 32) | m_words[i];
+			m_words[i] = t / x;
+			rem = t % x;
+		}
+		if(rem)
+			m_sticky = true;
+		Trim();
+	}
+
+	void ShiftLeft(int bits)
+	{
+		if(m_len == 0)
+			return;
+
+		int nwords = bits / 32;
+		int nbits = bits % 32;
+
+		m_words[m_len] = 0;
+		for(int i=m_len; i>=0; i--)
+		{
+			uint32_t hi = m_words[i] << nbits;
+			uint32_t lo = (nbits && i) ? (m_words[i-1] >> (32 - nbits)) : 0;
+			m_words[i + nwords] = hi | lo;
+		}
+		for(int i=0; i<nwords; i++)
+			m_words[i] = 0;
+
+		m_len += nwords + 1;
+		Trim();
+	}
+
+	void ShiftRight(int bits)
+	{
+		int nwords = bits / 32;
+		int nbits = bits % 32;
+		if(nwords >= m_len)
+		{
+			if(m_len)
+				m_sticky = true;
+			m_len = 0;
+			return;
+		}
+
+		for(int i=0; i<nwords; i++)
+		{
+			if(m_words[i])
+				m_sticky = true;
+		}
+		if(nbits && (m_words[nwords] & ((1u << nbits) - 1)) )
+			m_sticky = true;
+
+		for(int i=0; i+nwords < m_len; i++)
+		{
+			uint32_t lo = m_words[i + nwords] >> nbits;
+			uint32_t hi = (nbits && (i+nwords+1 < m_len)) ? (m_words[i+nwords+1] << (32 - nbits)) : 0;
+			m_words[i] = lo | hi;
+		}
+		m_len -= nwords;
+		Trim();
+	}
+
+	bool FitsIn64()
+	{ return m_len <= 2; }
+
+	uint64_t Get64()
+	{
+		uint64_t ret = 0;
+		if(m_len > 1)
+			ret = static_cast<uint64_t>(m_words[1]) << 32;
+		if(m_len > 0)
+			ret |= m_words[0];
+		return ret;
+	}
+
+	bool IsInexact()
+	{ return m_sticky; }
+
+	static const int MAX_WORDS = 36;
+
+protected:
+	void Trim()
+	{
+		while(m_len && !m_words[m_len-1])
+			m_len --;
+	}
+
+	uint32_t m_words[MAX_WORDS + 1];
+	int m_len;
+	bool m_sticky;
+};
+
+/**
+	@brief Computes round(m * 2^e * 10^k) exactly, ties to even
+
+	@return False if the result doesn't fit in 63 bits
+ */
+static bool ScaleToDecimal(uint64_t m, int e, int k, uint64_t& out)
+{
+	const uint32_t pow5_13 = 1220703125;
+	static const uint32_t pow5[13] = { 1, 5, 25, 125, 625, 3125, 15625, 78125, 390625, 1953125, 9765625, 48828125, 244140625 };
+
+	//Compute floor(2 * m * 2^e * 10^k) so the low bit is the rounding half bit.
+	//All multiplies and left shifts go first so nothing gets lost before it's scaled up.
+	FloatBigInt n(m);
+	int shift = e + k + 1;
+	if(k > 0)
+	{
+		int i = k;
+		for(; i >= 13; i -= 13)
+			n.MulSmall(pow5_13);
+		n.MulSmall(pow5[i]);
+	}
+	if(shift > 0)
+		n.ShiftLeft(shift);
+	if(k < 0)
+	{
+		int i = -k;
+		for(; i >= 13; i -= 13)
+			n.DivSmall(pow5_13);
+		n.DivSmall(pow5[i]);
+	}
+	if(shift < 0)
+		n.ShiftRight(-shift);
+
+	if(!n.FitsIn64())
+		return false;
+	uint64_t twice = n.Get64();
+	if(twice >> 63)
+		return false;
+
+	out = twice >> 1;
+	if( (twice & 1) && (n.IsInexact() || (out & 1)) )
+		out ++;
+	return true;
+}
+
+/**
+	@brief Converts a double to a decimal string in %f or %e style, using integer math only
+
+	Output is correctly rounded (ties to even, same as glibc) for every finite double. Values too large to print in %f
+	style with the requested precision (around 1.8e19 / 10^precision and up) are printed in %e style instead.
+
+	@param s			String to store into (must be 40+ bytes long)
+	@param value		Input
+	@param precision	Number of digits after the decimal point (up to 17). If zero, the decimal point is omitted.
+	@param exponential	True for %e style output, false for %f
+	@param upper		True for uppercase E, INF and NAN
+
+	@return str
+ */
+char* FormatFloat(char* s, double value, int precision, bool exponential, bool upper)
+{
+	static const uint64_t pow10[19] =
+	{
+		1ULL, 10ULL, 100ULL, 1000ULL, 10000ULL, 100000ULL, 1000000ULL, 10000000ULL, 100000000ULL, 1000000000ULL,
+		10000000000ULL, 100000000000ULL, 1000000000000ULL, 10000000000000ULL, 100000000000000ULL,
+		1000000000000000ULL, 10000000000000000ULL, 100000000000000000ULL, 1000000000000000000ULL
+	};
+
+	if(precision > 17)
+		precision = 17;
+
+	//Crack the IEEE 754 representation
+	uint64_t bits;
+	memcpy(&bits, &value, sizeof(bits));
+	int expfield = (bits >> 52) & 0x7ff;
+	uint64_t m = bits & 0xfffffffffffffULL;
+
+	char* p = s;
+	if(bits >> 63)
+		*(p++) = '-';
+
+	if(expfield == 0x7ff)
+	{
+		if(m)
+			strcpy(p, upper ? "NAN" : "nan");
+		else
+			strcpy(p, upper ? "INF" : "inf");
+		return s;
+	}
+
+	int e;
+	if(expfield == 0)
+		e = -1074;
+	else
+	{
+		m |= (1ULL << 52);
+		e = expfield - 1075;
+	}
+
+	//Fixed point style, if it fits
+	uint64_t n;
+	if(!exponential)
+	{
+		if( (m == 0) || ( (64 - __builtin_clzll(m) + e) <= 64 && ScaleToDecimal(m, e, precision, n) ) )
+		{
+			if(m == 0)
+				n = 0;
+			ulltoa(n / pow10[precision], p);
+			if(precision > 0)
+			{
+				p += strlen(p);
+				*(p++) = '.';
+				FormatDecimalDigits(p, n % pow10[precision], precision);
+			}
+			return s;
+		}
+	}
+
+	//Exponential style. Estimate the decimal exponent from the binary one, then correct if off by one.
+	int dexp = 0;
+	if(m == 0)
+		n = 0;
+	else
+	{
+		int bitlen = 64 - __builtin_clzll(m) + e;
+		dexp = ((bitlen - 1) * 1233) >> 12;
+		while(true)
+		{
+			ScaleToDecimal(m, e, precision - dexp, n);
+			if(n >= pow10[precision + 1])
+			{
+				//Rounded up to the next power of ten, this one is exact
+				if(n == pow10[precision + 1])
+				{
+					n /= 10;
+					dexp ++;
+					break;
+				}
+				dexp ++;
+			}
+			else if(n < pow10[precision])
+				dexp --;
+			else
+			{
+				//If we rounded up to exactly 10^precision, the true value may belong one decade lower
+				uint64_t nlow;
+				if( (n == pow10[precision]) &&
+					ScaleToDecimal(m, e, precision - dexp + 1, nlow) &&
+					(nlow < pow10[precision + 1]) )
+				{
+					n = nlow;
+					dexp --;
+				}
+				break;
+			}
+		}
+	}
+
+	//Leading digit, then the rest
+	*(p++) = '0' + (n / pow10[precision]);
+	if(precision > 0)
+	{
+		*(p++) = '.';
+		FormatDecimalDigits(p, n % pow10[precision], precision);
+		p += precision;
+	}
+
+	*(p++) = upper ? 'E' : 'e';
+	if(dexp < 0)
+	{
+		*(p++) = '-';
+		dexp = -dexp;
+	}
+	else
+		*(p++) = '+';
+	if(dexp < 10)
+		*(p++) = '0';
+	utoa(dexp, p);
+
+	return s;
+}
+
+/**
+	@brief Pads a formatted number, putting zero padding after the sign like printf does
+ */
+static void WritePaddedNumber(CharacterDevice* target, const char* str, int length, char padchar, bool prepad)
+{
+	if( (str[0] == '-') && (padchar == '0') && prepad)
+	{
+		target->PrintBinary('-');
+		str ++;
+		length --;
+	}
+	target->WritePadded(str, length, padchar, prepad);
+}
+
 /**
 	@brief Stripped-down printf implementation adapted from my old PICNIX project.
 
@@ -112,11 +599,10 @@ void DoPrintf(CharacterDevice* target, const char* format, __builtin_va_list arg
 {
 	//Parsing helpers
 	const int buflen = 32;	//must be large enough for INT_MAX plus null
+	const int maxPrecision = buflen - 23;
 	char buf[buflen+1];
 	const char* pch;
 	int bufpos = 0;
-	static const char hex[] = "0123456789abcdef";
-	static const char Hex[] = "0123456789ABCDEF";
 	unsigned int d;
 
 	//Go through the format string and process it
@@ -154,9 +640,36 @@ void DoPrintf(CharacterDevice* target, const char* format, __builtin_va_list arg
 					length = (length*10) + (type - '0');
 				type = format[++i];
 			}
+			if(type == '*')
+			{
+				length = __builtin_va_arg(args, int);
+				if(length < 0)
+				{
+					prepad = false;
+					length = -length;
+				}
+				type = format[++i];
+			}
+
+			//Zero padding doesn't apply to left justified fields
+			if(!prepad)
+				padchar = ' ';
+
+			int precision = -1;
+			if(type == '.')
+			{
+				precision = 0;
+				type = format[++i];
+				while(isdigit(type))
+				{
+					precision = (precision*10) + (type - '0');
+					type = format[++i];
+				}
+			}
 
 			//Look for a modifier
 			int modwidth = 0;
+			int modlong = 0;
 			bool modsign = true;
 			bool done = false;
 			while(!done)
@@ -168,6 +681,11 @@ void DoPrintf(CharacterDevice* target, const char* format, __builtin_va_list arg
 						type = format[++i];
 						break;
 
+					case 'l':
+						modlong ++;
+						type = format[++i];
+						break;
+
 					case 'u':
 						modsign = false;
 						type = format[++i];
@@ -178,6 +696,9 @@ void DoPrintf(CharacterDevice* target, const char* format, __builtin_va_list arg
 				}
 			}
 
+			//64-bit integer argument (%lld, %llu, %llx, or %ld etc. on LP64 hosts)
+			bool wide = (modlong >= 2) || (modlong && (sizeof(long) > 4) );
+
 			switch(type)
 			{
 			case '%':
@@ -185,40 +706,92 @@ void DoPrintf(CharacterDevice* target, const char* format, __builtin_va_list arg
 				break;
 
 			case 'u':
-				utoa(__builtin_va_arg(args, unsigned int), buf);
+				if(wide)
+					ulltoa(__builtin_va_arg(args, uint64_t), buf);
+				else
+					utoa(__builtin_va_arg(args, unsigned int), buf);
 				target->WritePadded(buf, length, padchar, prepad);
 				break;
 
 			case 'd':
-				itoa(__builtin_va_arg(args, int), buf);
-				target->WritePadded(buf, length, padchar, prepad);
+				if(wide)
+					lltoa(__builtin_va_arg(args, int64_t), buf);
+				else
+					itoa(__builtin_va_arg(args, int), buf);
+				WritePaddedNumber(target, buf, length, padchar, prepad);
 				break;
 
-			//Nonstandard extension: Fixed point integer (_Accum)
+			//Nonstandard extension: Fixed point integer (_Accum), passed as the raw integer value.
+			//%hk = 8.8, %k = 16.16, %lk = 32.32, add u for unsigned. Default precision is 3 digits.
+			//Field width applies to the integer part only.
 			case 'k':
-
-				//16-bit fixed point types
-				if(modwidth == 2)
 				{
-					//unsigned short _Accum / ufix8_8_t / %uhk
-					if(!modsign)
+					uint64_t mag;
+					int fracbits;
+					if(modlong)
+					{
+						fracbits = 32;
+						mag = __builtin_va_arg(args, uint64_t);
+					}
+					else if(modwidth == 2)
+					{
+						//While it's logically 16 bits, it will be promoted to 32 by vararg convention
+						fracbits = 8;
+						int fixval = __builtin_va_arg(args, int);
+						if(modsign)
+							mag = static_cast<int64_t>(static_cast<int16_t>(fixval));
+						else
+							mag = static_cast<uint16_t>(fixval);
+					}
+					else
+					{
+						fracbits = 16;
+						if(modsign)
+							mag = static_cast<int64_t>(__builtin_va_arg(args, int32_t));
+						else
+							mag = __builtin_va_arg(args, uint32_t);
+					}
+
+					bool negative = false;
+					if(modsign && (static_cast<int64_t>(mag) < 0) )
 					{
-						//Crack fixed point value to integer and fractional parts
-						//(note, while it's logically 8.8 so 16 bits, it will be promoted to 32 by vararg convention)
-						auto fixval = __builtin_va_arg(args, int);
-
-						//Print real part, padded as requested
-						itoa(fixval >> 8, buf);
-						target->WritePadded(buf, length, padchar, prepad);
-						target->PrintBinary('.');
-
-						//Print fractional part, with fixed 3-digit precision
-						int frac = fixval & 0xff;
-						itoa(frac * 1000 / 256, buf);
-						target->WritePadded(buf, 3, '0', true);
+						negative = true;
+						mag = -mag;
 					}
+
+					if(precision < 0)
+						precision = 3;
+					else if(precision > maxPrecision)
+						precision = maxPrecision;
+					FormatFixed(buf, mag, fracbits, negative, precision);
+
+					//Pad the integer part only
+					int intlen = strcspn(buf, ".");
+					WritePaddedNumber(target, buf, length + strlen(buf) - intlen, padchar, prepad);
 				}
+				break;
 
+			//Floating point, integer math only. Default precision is 6 digits.
+			case 'f':
+			case 'F':
+			case 'e':
+			case 'E':
+				{
+					char fbuf[40];
+					if(precision < 0)
+						precision = 6;
+					FormatFloat(
+						fbuf,
+						__builtin_va_arg(args, double),
+						precision,
+						(type == 'e') || (type == 'E'),
+						(type == 'F') || (type == 'E'));
+
+					//Zero padding goes after the sign, and never applies to inf/nan
+					if(!isdigit(fbuf[strlen(fbuf) - 1]))
+						padchar = ' ';
+					WritePaddedNumber(target, fbuf, length, padchar, prepad);
+				}
 				break;
 
 			case 'c':
@@ -234,34 +807,30 @@ void DoPrintf(CharacterDevice* target, const char* format, __builtin_va_list arg
 			case 'x':
 			case 'X':
 				{
-					d = __builtin_va_arg(args, unsigned int);
-					int bFirst = 1;
-					for(int j=0; j<8; j++)
-					{
-						//Grab the next 4 bits
-						unsigned int x = d >> 28;
-
-						//Print it
-						char ch = hex[x];
-						if(format[i] == 'X')					//capitalize
-							ch = Hex[x];
-
-						//Skip leading zeros unless we are padding
-						//but print a single 0 if it's zero
-						if( (ch == '0') && bFirst && (j != 7) )
-						{
-							if( (8 - j) <= length)
-								target->PrintBinary(padchar);
-						}
-						else
-						{
-							target->PrintBinary(ch);
-							bFirst = 0;
-						}
+					//Build the whole padded field in the buffer and send it in one go
+					uint64_t hex;
+					if(wide)
+						hex = __builtin_va_arg(args, uint64_t);
+					else
+						hex = __builtin_va_arg(args, unsigned int);
+					int ndigits = HexDigitCount(hex);
+					int width = length;
+					if(width < ndigits)
+						width = ndigits;
+					if(width > buflen)
+						width = buflen;
 
-						//Shift off what we just printed
-						d <<= 4;
+					if(prepad)
+					{
+						memset(buf, padchar, width - ndigits);
+						FormatHex(buf + width - ndigits, hex, ndigits, type == 'X');
 					}
+					else
+					{
+						FormatHex(buf, hex, ndigits, type == 'X');
+						memset(buf + ndigits, padchar, width - ndigits);
+					}
+					target->Write(buf, width);
 				}
 				break;
 
@@ -270,7 +839,10 @@ void DoPrintf(CharacterDevice* target, const char* format, __builtin_va_list arg
 				if(!modsign)
 				{
 					i--;
-					utoa(__builtin_va_arg(args, unsigned int), buf);
+					if(wide)
+						ulltoa(__builtin_va_arg(args, uint64_t), buf);
+					else
+						utoa(__builtin_va_arg(args, unsigned int), buf);
 					target->WritePadded(buf, length, padchar, prepad);
 					continue;
 				}
@@ -301,20 +873,342 @@ void DoPrintf(CharacterDevice* target, const char* format, __builtin_va_list arg
 	}
 }
 
+/**
+	@brief Prints a hex dump of a block of memory, 16 bytes per line
+
+	Each line is formatted in a local buffer and sent to the target with a single bulk write.
+
+	@param target	Device to print to
+	@param ptr		Start of the block to dump
+	@param len		Number of bytes to dump
+ */
+void HexDump(CharacterDevice* target, const void* ptr, uint32_t len)
+{
+	auto p = reinterpret_cast<const uint8_t*>(ptr);
+
+	//Offset, colon and space, three chars per byte, space, one ASCII char per byte
+	const uint32_t bytesPerLine = 16;
+	char line[10 + 3*bytesPerLine + 1 + bytesPerLine];
+
+	for(uint32_t base=0; base<len; base += bytesPerLine)
+	{
+		uint32_t nbytes = len - base;
+		if(nbytes > bytesPerLine)
+			nbytes = bytesPerLine;
+
+		char* w = FormatHex(line, base, 8);
+		*(w++) = ':';
+		*(w++) = ' ';
+
+		//Hex bytes, padding short lines so the ASCII column stays aligned
+		for(uint32_t i=0; i<bytesPerLine; i++)
+		{
+			if(i < nbytes)
+				w = FormatHex(w, p[base + i], 2);
+			else
+			{
+				*(w++) = ' ';
+				*(w++) = ' ';
+			}
+			*(w++) = ' ';
+		}
+		*(w++) = ' ';
+
+		//ASCII
+		for(uint32_t i=0; i<nbytes; i++)
+		{
+			uint8_t ch = p[base + i];
+			*(w++) = isprint(ch) ? ch : '.';
+		}
+
+		target->Write(line, w - line);
+		target->PrintText('\n');
+	}
+}
+
 /**
 	@brief Remove spaces from trailing edge of a string
  */
 void TrimSpaces(char* str)
 {
-	char* p = str + strlen(str) - 1;
+	char* p = str + FastStrlen(str);
+
+	while( (p > str) && isspace(static_cast<unsigned char>(p[-1])) )
+		p --;
+	*p = '\0';
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// Word-at-a-time (SWAR) string scanning and parsing
+
+//All of our targets are little endian, the SWAR digit packing below depends on this
+#if __BYTE_ORDER__ != __ORDER_LITTLE_ENDIAN__
+#error StringHelpers SWAR code assumes a little endian target
+#endif
+
+typedef uint32_t __attribute__((may_alias)) aliased_u32;
+
+static const uint32_t SWAR_ONES = 0x01010101;
+static const uint32_t SWAR_HIGHS = 0x80808080;
+
+///@brief Nonzero if any byte of v is zero
+static inline uint32_t SwarHasZero(uint32_t v)
+{ return (v - SWAR_ONES) & ~v & SWAR_HIGHS; }
+
+///@brief Loads four possibly unaligned bytes, first byte in the LSB
+static inline uint32_t SwarLoad(const char* p)
+{
+	uint32_t v;
+	memcpy(&v, p, 4);
+	return v;
+}
+
+/**
+	@brief Sets the high bit of each byte of v that is strictly between lo and hi
+
+	Only valid if every byte of v is less than 0x80.
+ */
+static inline uint32_t SwarBetween(uint32_t v, uint8_t lo, uint8_t hi)
+{
+	return ( (SWAR_ONES * (127 + hi) - v) & ~v & (v + SWAR_ONES * (127 - lo)) ) & SWAR_HIGHS;
+}
+
+/**
+	@brief strlen() that tests a whole word per iteration
+
+	Once the pointer is aligned, reads whole aligned words, which may run past the terminator but never past the end
+	of the word containing it (so can't cross into an unmapped page or peripheral). AddressSanitizer can't tell that
+	apart from a real overrun, so it's disabled here for host builds.
+ */
+__attribute__((no_sanitize("address")))
+size_t FastStrlen(const char* str)
+{
+	const char* p = str;
 
-	while(p >= str)
+	//Byte at a time until aligned
+	while(reinterpret_cast<uintptr_t>(p) & 3)
 	{
-		if(isspace(*p))
-			*p = '\0';
-		else
+		if(!*p)
+			return p - str;
+		p ++;
+	}
+
+	//Word at a time until one of them contains a null
+	auto w = reinterpret_cast<const aliased_u32*>(p);
+	while(!SwarHasZero(*w))
+		w ++;
+
+	//Find it within the word
+	p = reinterpret_cast<const char*>(w);
+	while(*p)
+		p ++;
+	return p - str;
+}
+
+/**
+	@brief memchr() that tests four bytes per iteration
+
+	Never reads outside [str, str+len).
+ */
+const char* FastMemchr(const char* str, char ch, size_t len)
+{
+	const char* end = str + len;
+	uint32_t pattern = SWAR_ONES * static_cast<uint8_t>(ch);
+
+	const char* p = str;
+	for(; p + 4 <= end; p += 4)
+	{
+		if(SwarHasZero(SwarLoad(p) ^ pattern))
 			break;
+	}
 
-		p --;
+	for(; p < end; p++)
+	{
+		if(*p == ch)
+			return p;
+	}
+	return nullptr;
+}
+
+/**
+	@brief Checks that all four bytes of v are ASCII decimal digits
+ */
+static inline bool SwarIsDecimal4(uint32_t v)
+{
+	return ( (v & 0xf0f0f0f0) == 0x30303030 ) && ( ((v + 0x06060606) & 0xf0f0f0f0) == 0x30303030 );
+}
+
+/**
+	@brief Converts four ASCII decimal digits (first digit in the LSB) to an integer 0-9999
+ */
+static inline uint32_t SwarDecimal4(uint32_t v)
+{
+	v -= 0x30303030;
+	v = (v * 10) + (v >> 8);
+	return ( (v & 0x00ff00ff) * (1 + (100 << 16)) ) >> 16;
+}
+
+/**
+	@brief Parses an unsigned decimal integer, four digits per step
+
+	The whole string must be digits, with no sign, prefix, or whitespace.
+
+	@param str	String to parse (need not be null terminated)
+	@param len	Length of the string
+	@param out	Result (only written on success)
+
+	@return True on success, false if empty, invalid, or out of range
+ */
+bool ParseU32(const char* str, size_t len, uint32_t& out)
+{
+	if(len == 0)
+		return false;
+
+	uint32_t acc = 0;
+	size_t i = 0;
+	for(; i + 4 <= len; i += 4)
+	{
+		uint32_t v = SwarLoad(str + i);
+		if(!SwarIsDecimal4(v))
+			return false;
+		uint32_t chunk = SwarDecimal4(v);
+		if(acc > (0xffffffff - chunk) / 10000)
+			return false;
+		acc = acc*10000 + chunk;
+	}
+
+	for(; i < len; i++)
+	{
+		uint32_t digit = static_cast<uint8_t>(str[i]) - '0';
+		if(digit > 9)
+			return false;
+		if(acc > (0xffffffff - digit) / 10)
+			return false;
+		acc = acc*10 + digit;
+	}
+
+	out = acc;
+	return true;
+}
+
+/**
+	@brief Parses an unsigned hex integer, four digits per step
+
+	An optional 0x or 0X prefix is allowed. Leading zeros don't count toward the 8 digit limit.
+
+	@param str	String to parse (need not be null terminated)
+	@param len	Length of the string
+	@param out	Result (only written on success)
+
+	@return True on success, false if empty, invalid, or out of range
+ */
+bool ParseHex(const char* str, size_t len, uint32_t& out)
+{
+	if( (len > 2) && (str[0] == '0') && ( (str[1] | 0x20) == 'x') )
+	{
+		str += 2;
+		len -= 2;
+	}
+	if(len == 0)
+		return false;
+
+	uint32_t acc = 0;
+	size_t i = 0;
+	for(; i + 4 <= len; i += 4)
+	{
+		uint32_t v = SwarLoad(str + i);
+		if(v & SWAR_HIGHS)
+			return false;
+
+		//Folding to lowercase doesn't affect digits, which already have 0x20 set
+		uint32_t lower = v | 0x20202020;
+		uint32_t digits = SwarBetween(v, '0' - 1, '9' + 1);
+		uint32_t letters = SwarBetween(lower, 'a' - 1, 'f' + 1);
+		if( (digits | letters) != SWAR_HIGHS)
+			return false;
+
+		//Nibble values, then pack four of them together (first digit is most significant)
+		uint32_t nibbles = (lower & 0x0f0f0f0f) + (letters >> 7) * 9;
+		uint32_t pairs = ( (nibbles & 0x000f000f) << 4) | ( (nibbles >> 8) & 0x000f000f);
+		uint32_t chunk = ( (pairs & 0xff) << 8) | ( (pairs >> 16) & 0xff);
+
+		if(acc >> 16)
+			return false;
+		acc = (acc << 16) | chunk;
+	}
+
+	for(; i < len; i++)
+	{
+		uint8_t ch = str[i];
+		uint32_t nibble;
+		if( (ch >= '0') && (ch <= '9') )
+			nibble = ch - '0';
+		else if( ( (ch | 0x20) >= 'a') && ( (ch | 0x20) <= 'f') )
+			nibble = (ch | 0x20) - 'a' + 10;
+		else
+			return false;
+
+		if(acc >> 28)
+			return false;
+		acc = (acc << 4) | nibble;
 	}
+
+	out = acc;
+	return true;
+}
+
+/**
+	@brief Parses a signed decimal integer, four digits per step
+
+	An optional leading + or - is allowed.
+
+	@param str	String to parse (need not be null terminated)
+	@param len	Length of the string
+	@param out	Result (only written on success)
+
+	@return True on success, false if empty, invalid, or out of range
+ */
+bool ParseI64(const char* str, size_t len, int64_t& out)
+{
+	bool negative = false;
+	if( (len > 0) && ( (str[0] == '-') || (str[0] == '+') ) )
+	{
+		negative = (str[0] == '-');
+		str ++;
+		len --;
+	}
+	if(len == 0)
+		return false;
+
+	//Magnitude limit is one larger for negative numbers
+	uint64_t limit = 0x7fffffffffffffffULL + (negative ? 1 : 0);
+
+	uint64_t acc = 0;
+	size_t i = 0;
+	for(; i + 4 <= len; i += 4)
+	{
+		uint32_t v = SwarLoad(str + i);
+		if(!SwarIsDecimal4(v))
+			return false;
+		uint32_t chunk = SwarDecimal4(v);
+		if(acc > (limit - chunk) / 10000)
+			return false;
+		acc = acc*10000 + chunk;
+	}
+
+	for(; i < len; i++)
+	{
+		uint32_t digit = static_cast<uint8_t>(str[i]) - '0';
+		if(digit > 9)
+			return false;
+		if(acc > (limit - digit) / 10)
+			return false;
+		acc = acc*10 + digit;
+	}
+
+	if(negative)
+		out = static_cast<int64_t>(0 - acc);
+	else
+		out = static_cast<int64_t>(acc);
+	return true;
 }
@@ -30,14 +30,31 @@
 #ifndef StringHelpers_h
 #define StringHelpers_h
 
+#include <stdint.h>
+#include <stddef.h>
+
 class CharacterDevice;
 
 char* reverse(char* s);
 char* itoa(int n, char* s);
 char* utoa(unsigned int n, char* s);
+char* ulltoa(uint64_t n, char* s);
+char* lltoa(int64_t n, char* s);
+char* FormatHex(char* s, uint64_t n, int ndigits, bool upper = false);
+char* FormatFixed(char* s, uint64_t mag, int fracbits, bool negative, int precision);
+char* FormatFloat(char* s, double value, int precision, bool exponential, bool upper = false);
 
 void DoPrintf(CharacterDevice* target, const char* format, __builtin_va_list args);
 
+void HexDump(CharacterDevice* target, const void* ptr, uint32_t len);
+
 void TrimSpaces(char* str);
 
+size_t FastStrlen(const char* str);
+const char* FastMemchr(const char* str, char ch, size_t len);
+
+bool ParseU32(const char* str, size_t len, uint32_t& out);
+bool ParseHex(const char* str, size_t len, uint32_t& out);
+bool ParseI64(const char* str, size_t len, int64_t& out);
+
 #endif
@@ -0,0 +1,154 @@
+/***********************************************************************************************************************
+*                                                                                                                      *
+* embedded-utils                                                                                                       *
+*                                                                                                                      *
+* Copyright (c) 2020-2025 Andrew D. Zonenberg                                                                          *
+* All rights reserved.                                                                                                 *
+*                                                                                                                      *
+* Redistribution and use in source and binary forms, with or without modification, are permitted provided that the     *
+* following conditions are met:                                                                                        *
+*                                                                                                                      *
+*    * Redistributions of source code must retain the above copyright notice, this list of conditions, and the         *
+*      following disclaimer.                                                                                           *
+*                                                                                                                      *
+*    * Redistributions in binary form must reproduce the above copyright notice, this list of conditions and the       *
+*      following disclaimer in the documentation and/or other materials provided with the distribution.                *
+*                                                                                                                      *
+*    * Neither the name of the author nor the names of any contributors may be used to endorse or promote products     *
+*      derived from this software without specific prior written permission.                                           *
+*                                                                                                                      *
+* THIS SOFTWARE IS PROVIDED BY THE AUTHORS "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED   *
+* TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL *
+* THE AUTHORS BE HELD LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES        *
+* (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR       *
+* BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT *
+* (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE       *
+* POSSIBILITY OF SUCH DAMAGE.                                                                                          *
+*                                                                                                                      *
+***********************************************************************************************************************/
+
+#ifndef StringTokenizer_h
+#define StringTokenizer_h
+
+#include <stdint.h>
+#include <string.h>
+#include <ctype.h>
+
+#include "StringHelpers.h"
+
+/**
+	@brief Non-owning reference to a run of characters, which need not be null terminated
+ */
+class StringView
+{
+public:
+	StringView()
+	: m_ptr(nullptr)
+	, m_len(0)
+	{}
+
+	StringView(const char* ptr, size_t len)
+	: m_ptr(ptr)
+	, m_len(len)
+	{}
+
+	StringView(const char* str)
+	: m_ptr(str)
+	, m_len(FastStrlen(str))
+	{}
+
+	const char* data() const
+	{ return m_ptr; }
+
+	size_t length() const
+	{ return m_len; }
+
+	bool empty() const
+	{ return m_len == 0; }
+
+	char operator[](size_t i) const
+	{ return m_ptr[i]; }
+
+	///@brief Compares against a null terminated string
+	bool operator==(const char* str) const
+	{ return (strncmp(m_ptr, str, m_len) == 0) && (str[m_len] == '\0'); }
+
+	bool operator!=(const char* str) const
+	{ return !(*this == str); }
+
+	///@brief Returns a view with leading and trailing whitespace removed
+	StringView Trim() const
+	{
+		const char* start = m_ptr;
+		const char* end = m_ptr + m_len;
+		while( (start < end) && isspace(static_cast<unsigned char>(*start)) )
+			start ++;
+		while( (end > start) && isspace(static_cast<unsigned char>(end[-1])) )
+			end --;
+		return StringView(start, end - start);
+	}
+
+	bool ParseU32(uint32_t& out) const
+	{ return ::ParseU32(m_ptr, m_len, out); }
+
+	bool ParseHex(uint32_t& out) const
+	{ return ::ParseHex(m_ptr, m_len, out); }
+
+	bool ParseI64(int64_t& out) const
+	{ return ::ParseI64(m_ptr, m_len, out); }
+
+protected:
+	const char* m_ptr;
+	size_t m_len;
+};
+
+/**
+	@brief Splits a string into tokens in place, without copying or modifying it
+
+	Runs of consecutive delimiters are treated as a single separator (like strtok), so empty tokens are never returned.
+ */
+class StringTokenizer
+{
+public:
+	StringTokenizer(StringView str, char delim = ' ')
+	: m_rest(str)
+	, m_delim(delim)
+	{}
+
+	/**
+		@brief Gets the next token
+
+		@return True if a token was found, false if the end of the string was reached
+	 */
+	bool Next(StringView& token)
+	{
+		const char* p = m_rest.data();
+		const char* end = p + m_rest.length();
+
+		while( (p < end) && (*p == m_delim) )
+			p ++;
+		if(p == end)
+		{
+			m_rest = StringView(end, 0);
+			return false;
+		}
+
+		const char* tokend = FastMemchr(p, m_delim, end - p);
+		if(!tokend)
+			tokend = end;
+
+		token = StringView(p, tokend - p);
+		m_rest = StringView(tokend, end - tokend);
+		return true;
+	}
+
+	///@brief Gets everything not yet tokenized, e.g. free-form text at the end of a command
+	StringView Rest() const
+	{ return m_rest; }
+
+protected:
+	StringView m_rest;
+	char m_delim;
+};
+
+#endif
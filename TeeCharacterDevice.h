@@ -0,0 +1,133 @@
+/***********************************************************************************************************************
+*                                                                                                                      *
+* embedded-utils                                                                                                       *
+*                                                                                                                      *
+* Copyright (c) 2020-2025 Andrew D. Zonenberg                                                                          *
+* All rights reserved.                                                                                                 *
+*                                                                                                                      *
+* Redistribution and use in source and binary forms, with or without modification, are permitted provided that the     *
+* following conditions are met:                                                                                        *
+*                                                                                                                      *
+*    * Redistributions of source code must retain the above copyright notice, this list of conditions, and the         *
+*      following disclaimer.                                                                                           *
+*                                                                                                                      *
+*    * Redistributions in binary form must reproduce the above copyright notice, this list of conditions and the       *
+*      following disclaimer in the documentation and/or other materials provided with the distribution.                *
+*                                                                                                                      *
+*    * Neither the name of the author nor the names of any contributors may be used to endorse or promote products     *
+*      derived from this software without specific prior written permission.                                           *
+*                                                                                                                      *
+* THIS SOFTWARE IS PROVIDED BY THE AUTHORS "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED   *
+* TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL *
+* THE AUTHORS BE HELD LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES        *
+* (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR       *
+* BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT *
+* (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE       *
+* POSSIBILITY OF SUCH DAMAGE.                                                                                          *
+*                                                                                                                      *
+***********************************************************************************************************************/
+
+#ifndef TeeCharacterDevice_h
+#define TeeCharacterDevice_h
+
+#include "CharacterDevice.h"
+#include "LogRecordFilter.h"
+
+/**
+	@brief A character device which sends everything written to it to two other devices
+
+	For example, to keep a CrashLog of everything the Logger sends to the UART. Reads come from the first device.
+
+	Every output call is forwarded to the same method of both devices, so each keeps its own text handling. A device
+	which filters log records (such as LogSink) can be passed as its own filter as well. Give the tee to
+	Logger::SetRecordFilter(), and it forwards the record calls to each filter and wants any record either device wants.
+ */
+class TeeCharacterDevice
+	: public CharacterDevice
+	, public LogRecordFilter
+{
+public:
+	TeeCharacterDevice(
+		CharacterDevice* first,
+		CharacterDevice* second,
+		LogRecordFilter* firstFilter = nullptr,
+		LogRecordFilter* secondFilter = nullptr)
+	: m_first(first)
+	, m_second(second)
+	, m_firstFilter(firstFilter)
+	, m_secondFilter(secondFilter)
+	{}
+
+	virtual void PrintBinary(char ch) override
+	{
+		m_first->PrintBinary(ch);
+		m_second->PrintBinary(ch);
+	}
+
+	virtual void PrintText(char ch) override
+	{
+		m_first->PrintText(ch);
+		m_second->PrintText(ch);
+	}
+
+	virtual void Write(const char* data, uint32_t len) override
+	{
+		m_first->Write(data, len);
+		m_second->Write(data, len);
+	}
+
+	virtual void PrintString(const char* str) override
+	{
+		m_first->PrintString(str);
+		m_second->PrintString(str);
+	}
+
+	virtual void Flush() override
+	{
+		m_first->Flush();
+		m_second->Flush();
+	}
+
+	virtual char BlockingRead() override
+	{ return m_first->BlockingRead(); }
+
+	///@brief A device without a filter wants every record
+	virtual bool WantsRecord(uint8_t type, uint8_t module) override
+	{
+		if(!m_firstFilter || !m_secondFilter)
+			return true;
+		return m_firstFilter->WantsRecord(type, module) || m_secondFilter->WantsRecord(type, module);
+	}
+
+	virtual void BeginRecord(uint8_t type, uint8_t module) override
+	{
+		if(m_firstFilter)
+			m_firstFilter->BeginRecord(type, module);
+		if(m_secondFilter)
+			m_secondFilter->BeginRecord(type, module);
+	}
+
+	virtual void EndRecord() override
+	{
+		if(m_firstFilter)
+			m_firstFilter->EndRecord();
+		if(m_secondFilter)
+			m_secondFilter->EndRecord();
+	}
+
+	virtual void SetStructured(bool structured) override
+	{
+		if(m_firstFilter)
+			m_firstFilter->SetStructured(structured);
+		if(m_secondFilter)
+			m_secondFilter->SetStructured(structured);
+	}
+
+protected:
+	CharacterDevice* m_first;
+	CharacterDevice* m_second;
+	LogRecordFilter* m_firstFilter;
+	LogRecordFilter* m_secondFilter;
+};
+
+#endif
@@ -0,0 +1,266 @@
+/***********************************************************************************************************************
+*                                                                                                                      *
+* embedded-utils                                                                                                       *
+*                                                                                                                      *
+* Copyright (c) 2020-2025 Andrew D. Zonenberg                                                                          *
+* All rights reserved.                                                                                                 *
+*                                                                                                                      *
+* Redistribution and use in source and binary forms, with or without modification, are permitted provided that the     *
+* following conditions are met:                                                                                        *
+*                                                                                                                      *
+*    * Redistributions of source code must retain the above copyright notice, this list of conditions, and the         *
+*      following disclaimer.                                                                                           *
+*                                                                                                                      *
+*    * Redistributions in binary form must reproduce the above copyright notice, this list of conditions and the       *
+*      following disclaimer in the documentation and/or other materials provided with the distribution.                *
+*                                                                                                                      *
+*    * Neither the name of the author nor the names of any contributors may be used to endorse or promote products     *
+*      derived from this software without specific prior written permission.                                           *
+*                                                                                                                      *
+* THIS SOFTWARE IS PROVIDED BY THE AUTHORS "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED   *
+* TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL *
+* THE AUTHORS BE HELD LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES        *
+* (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR       *
+* BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT *
+* (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE       *
+* POSSIBILITY OF SUCH DAMAGE.                                                                                          *
+*                                                                                                                      *
+***********************************************************************************************************************/
+
+#ifndef Tracer_h
+#define Tracer_h
+
+#include <stdint.h>
+#include "CharacterDevice.h"
+#include "MonotonicClock.h"
+
+//For now, assume any ARM platform is STM32 and anything else is antikernel-ipcores
+#ifdef __arm__
+#include <peripheral/Timer.h>
+#else
+#include <APB_Timer.h>
+#endif
+
+#if !defined(SIMULATION) && !defined(SOFTCORE_NO_IRQ) && !defined(__ARM_ARCH_7M__) && !defined(__ARM_ARCH_7EM__) && \
+	!defined(__ARM_ARCH_8M_MAIN__)
+#include <stm32.h>
+#endif
+
+#ifdef HAVE_TIM
+
+/**
+	@file
+	@brief Span and event tracing, converted to Chrome/Perfetto trace JSON on the host by tools/trace_to_chrome.py
+
+	Event names go in the .logstr section, just like BINLOG() format strings, so they cost no flash and only their
+	address is recorded. See BinaryLogger.h for the linker script entry. Host builds must be linked with -no-pie so the
+	recorded addresses match the ELF.
+
+	Each event is three 32-bit little endian words:
+		timestamp	Low 32 bits of the MonotonicClock tick count, so it wraps at 32 bits whatever the width of the timer
+		id			Phase (TRACE_PHASE_xxx) in bits 31:30, address of the name in .logstr in bits 29:0
+		arg			Argument supplied by the caller
+
+	Dump() sends a header of four words (TRACE_MAGIC, clock ticks per second, number of events, number of older events
+	overwritten) followed by the events, oldest first. The decoder assumes less than one 32-bit wrap of the clock between
+	consecutive events.
+ */
+
+//Declares an event name in .logstr
+#define TRACE_CONCAT_(a, b) a##b
+#define TRACE_CONCAT(a, b) TRACE_CONCAT_(a, b)
+#define TRACE_NAME(var, name) __attribute__((section(".logstr"))) static const char var[] = name
+
+///@brief Records the start of a span
+#define TRACE_BEGIN(tracer, name, arg) \
+	do \
+	{ \
+		TRACE_NAME(trace_name_, name); \
+		(tracer).Begin(trace_name_, arg); \
+	} while(0)
+
+///@brief Records the end of a span, which must have the same name as the TRACE_BEGIN()
+#define TRACE_END(tracer, name, arg) \
+	do \
+	{ \
+		TRACE_NAME(trace_name_, name); \
+		(tracer).End(trace_name_, arg); \
+	} while(0)
+
+///@brief Records a single point in time
+#define TRACE_INSTANT(tracer, name, arg) \
+	do \
+	{ \
+		TRACE_NAME(trace_name_, name); \
+		(tracer).Instant(trace_name_, arg); \
+	} while(0)
+
+///@brief Records a span covering the rest of the enclosing scope
+#define TRACE_SCOPE(tracer, name, arg) \
+	TRACE_NAME(TRACE_CONCAT(trace_name_, __LINE__), name); \
+	TraceScope TRACE_CONCAT(trace_scope_, __LINE__)(tracer, TRACE_CONCAT(trace_name_, __LINE__), arg)
+
+///@brief Event phases, stored in the top bits of the id word
+enum TracePhase
+{
+	TRACE_PHASE_BEGIN	= 1,
+	TRACE_PHASE_END		= 2,
+	TRACE_PHASE_INSTANT	= 3
+};
+
+/**
+	@brief Records trace events into a ring buffer, overwriting the oldest when full
+
+	Recording an event is a slot claim plus three stores. The claim is an atomic increment where the CPU has one
+	(ARMv7-M and up, or the host), so events can be recorded from interrupts without masking them; elsewhere it's a
+	short critical section. Since the oldest events are overwritten rather than new ones dropped, the ring always holds
+	the most recent history. Stop recording with SetEnabled(false) before calling Dump(), or events being recorded
+	meanwhile may be torn.
+
+	Spans from interrupts are fine as long as they end before the interrupt returns, they're then nested in whatever
+	span was interrupted.
+
+	@tparam DEPTH	Ring size in events, must be a power of two
+ */
+template<uint32_t DEPTH = 256>
+class Tracer
+{
+public:
+	static_assert( (DEPTH & (DEPTH - 1)) == 0, "Tracer depth must be a power of two");
+
+	static const uint32_t TRACE_MAGIC = 0x31435254;	//"TRC1"
+	static const uint32_t ID_MASK = 0x3fffffff;
+
+	Tracer()
+	: m_clock(nullptr)
+	, m_enabled(true)
+	, m_wptr(0)
+	{}
+
+	/**
+		@brief Initializes the tracer
+
+		@param clock	Timebase to take timestamps from, normally the logger's (Logger::GetClock()) so trace events and
+						log messages line up. The clock extends narrow timers to 64 bits, as long as something reads it
+						at least once per half wrap of the timer (see Logger::UpdateOffset()).
+	 */
+	void Initialize(MonotonicClock* clock)
+	{ m_clock = clock; }
+
+	///@brief Starts or stops recording
+	void SetEnabled(bool enabled)
+	{ m_enabled = enabled; }
+
+	///@brief Discards everything recorded so far
+	void Clear()
+	{ m_wptr = 0; }
+
+	void Begin(const char* name, uint32_t arg = 0)
+	{ Record(TRACE_PHASE_BEGIN, name, arg); }
+
+	void End(const char* name, uint32_t arg = 0)
+	{ Record(TRACE_PHASE_END, name, arg); }
+
+	void Instant(const char* name, uint32_t arg = 0)
+	{ Record(TRACE_PHASE_INSTANT, name, arg); }
+
+	/**
+		@brief Records one event. Normally called through the TRACE_xxx() macros rather than directly.
+	 */
+	void Record(TracePhase phase, const char* name, uint32_t arg)
+	{
+		if(!m_enabled)
+			return;
+
+		auto& ev = m_events[Claim() & (DEPTH - 1)];
+		ev.m_timestamp = m_clock ? m_clock->GetTicks() : 0;
+		ev.m_id = (phase << 30) | (reinterpret_cast<uintptr_t>(name) & ID_MASK);
+		ev.m_arg = arg;
+	}
+
+	/**
+		@brief Sends the header and every event still in the ring to a device in raw binary form, oldest first
+	 */
+	void Dump(CharacterDevice* target)
+	{
+		uint32_t wptr = m_wptr;
+		uint32_t count = (wptr > DEPTH) ? DEPTH : wptr;
+
+		uint32_t rate = m_clock ? m_clock->GetTicksPerSecond() : 1;
+		uint32_t header[4] = { TRACE_MAGIC, rate, count, wptr - count };
+		target->Write(reinterpret_cast<const char*>(header), sizeof(header));
+
+		//Send up to the end of the buffer in one go
+		uint32_t rptr = wptr - count;
+		while(rptr != wptr)
+		{
+			uint32_t start = rptr & (DEPTH - 1);
+			uint32_t n = wptr - rptr;
+			if(start + n > DEPTH)
+				n = DEPTH - start;
+
+			target->Write(reinterpret_cast<const char*>(&m_events[start]), n * sizeof(Event));
+			rptr += n;
+		}
+	}
+
+protected:
+
+	struct Event
+	{
+		uint32_t m_timestamp;
+		uint32_t m_id;
+		uint32_t m_arg;
+	};
+
+	///@brief Claims the next slot of the ring
+	uint32_t Claim()
+	{
+		#if defined(SIMULATION) || defined(__ARM_ARCH_7M__) || defined(__ARM_ARCH_7EM__) || \
+			defined(__ARM_ARCH_8M_MAIN__)
+			return __atomic_fetch_add(&m_wptr, 1, __ATOMIC_RELAXED);
+		#elif defined(SOFTCORE_NO_IRQ)
+			uint32_t wptr = m_wptr;
+			m_wptr = wptr + 1;
+			return wptr;
+		#else
+			uint32_t sr = EnterCriticalSection();
+			uint32_t wptr = m_wptr;
+			m_wptr = wptr + 1;
+			LeaveCriticalSection(sr);
+			return wptr;
+		#endif
+	}
+
+	MonotonicClock* m_clock;
+	volatile bool m_enabled;
+
+	Event m_events[DEPTH];
+
+	///@brief Free-running event count, only masked when indexing the ring
+	volatile uint32_t m_wptr;
+};
+
+/**
+	@brief Records a span for the lifetime of the object, normally created through TRACE_SCOPE()
+ */
+template<class T>
+class TraceScope
+{
+public:
+	TraceScope(T& tracer, const char* name, uint32_t arg = 0)
+	: m_tracer(tracer)
+	, m_name(name)
+	{ tracer.Begin(name, arg); }
+
+	~TraceScope()
+	{ m_tracer.End(m_name); }
+
+protected:
+	T& m_tracer;
+	const char* m_name;
+};
+
+#endif
+
+#endif
@@ -0,0 +1,205 @@
+/***********************************************************************************************************************
+*                                                                                                                      *
+* embedded-utils                                                                                                       *
+*                                                                                                                      *
+* Copyright (c) 2020-2025 Andrew D. Zonenberg                                                                          *
+* All rights reserved.                                                                                                 *
+*                                                                                                                      *
+* Redistribution and use in source and binary forms, with or without modification, are permitted provided that the     *
+* following conditions are met:                                                                                        *
+*                                                                                                                      *
+*    * Redistributions of source code must retain the above copyright notice, this list of conditions, and the         *
+*      following disclaimer.                                                                                           *
+*                                                                                                                      *
+*    * Redistributions in binary form must reproduce the above copyright notice, this list of conditions and the       *
+*      following disclaimer in the documentation and/or other materials provided with the distribution.                *
+*                                                                                                                      *
+*    * Neither the name of the author nor the names of any contributors may be used to endorse or promote products     *
+*      derived from this software without specific prior written permission.                                           *
+*                                                                                                                      *
+* THIS SOFTWARE IS PROVIDED BY THE AUTHORS "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED   *
+* TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL *
+* THE AUTHORS BE HELD LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES        *
+* (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR       *
+* BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT *
+* (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE       *
+* POSSIBILITY OF SUCH DAMAGE.                                                                                          *
+*                                                                                                                      *
+***********************************************************************************************************************/
+
+/**
+	@file
+	@brief Differential test of FixedPoint arithmetic and the %k printf conversion
+
+	Multiply and divide of every standard format are checked against exact 128-bit integer math, rounding the same
+	way the class documents: multiply toward negative infinity, divide toward zero, wrapping on overflow. %k output is
+	checked against glibc %Lf on the exact value, including ties, negative values rounding to zero, and precisions past
+	the supported maximum. Pass a value count on the command line to run more or fewer cases.
+ */
+
+#include <stdlib.h>
+#include <math.h>
+#include <limits>
+#include <type_traits>
+
+#include "HostTest.h"
+#include "FixedPoint.h"
+
+typedef __int128 int128_t;
+typedef unsigned __int128 uint128_t;
+
+static uint64_t g_cases = 0;
+static uint64_t g_failures = 0;
+
+static void Fail(const char* what, int64_t a, int64_t b, int64_t got, int64_t expected)
+{
+	g_failures ++;
+	if(g_failures < 20)
+	{
+		printf("FAIL %s %llx, %llx: got %llx, expected %llx\n", what,
+			static_cast<unsigned long long>(a), static_cast<unsigned long long>(b),
+			static_cast<unsigned long long>(got), static_cast<unsigned long long>(expected));
+	}
+}
+
+/**
+	@brief Checks multiply, divide, Floor() and Round() of one pair of raw values against 128-bit reference math
+ */
+template<class F>
+static void CheckArithmetic(const char* name, typename F::raw_t a, typename F::raw_t b)
+{
+	typedef typename F::raw_t T;
+	typedef typename std::conditional<std::is_signed<T>::value, int128_t, uint128_t>::type W;
+	const int frac = F::FRAC_BITS;
+
+	F fa = F::FromRaw(a);
+	F fb = F::FromRaw(b);
+
+	//Shifting the exact product rounds toward negative infinity
+	T expected = static_cast<T>( (static_cast<W>(a) * static_cast<W>(b)) >> frac);
+	g_cases ++;
+	if( (fa * fb).Raw() != expected)
+		Fail(name, a, b, (fa * fb).Raw(), expected);
+
+	//128-bit divide rounds toward zero. Skip the divides that overflow a native integer divide too.
+	bool overflow = std::is_signed<T>::value && (a == std::numeric_limits<T>::min()) && (b == T(-1));
+	if( (b != 0) && !overflow)
+	{
+		W num = static_cast<W>(a) * (W(1) << frac);
+		expected = static_cast<T>(static_cast<uint64_t>(num / static_cast<W>(b)));
+		g_cases ++;
+		if( (fa / fb).Raw() != expected)
+			Fail(name, a, b, (fa / fb).Raw(), expected);
+	}
+
+	g_cases += 2;
+	expected = static_cast<T>(static_cast<W>(a) >> frac);
+	if(fa.Floor() != expected)
+		Fail("Floor", a, 0, fa.Floor(), expected);
+	expected = static_cast<T>( (static_cast<W>(a) + (W(1) << (frac - 1)) ) >> frac);
+	if(fa.Round() != expected)
+		Fail("Round", a, 0, fa.Round(), expected);
+}
+
+/**
+	@brief Checks %k output of one raw value at one precision against glibc
+
+	@param conv		Our conversion without the precision, e.g. "lk"
+	@param raw		Raw value, sign extended or zero extended to 64 bits the way the conversion reads it
+	@param frac		Fractional bits of the format
+ */
+template<class T>
+static void CheckFormat(const char* conv, T raw, int64_t value, bool isSigned, int frac, int precision)
+{
+	char ours[64];
+	char ref[64];
+	char fmt[16];
+	snprintf(fmt, sizeof(fmt), "%%.%d%s", precision, conv);
+	TestFormat(ours, sizeof(ours), fmt, raw);
+
+	//long double has a 64-bit mantissa, so every 32.32 value is exact. Precision is clamped at 9 digits.
+	long double d = isSigned ? static_cast<long double>(value) : static_cast<long double>(static_cast<uint64_t>(value));
+	d = ldexpl(d, -frac);
+	snprintf(ref, sizeof(ref), "%.*Lf", (precision > 9) ? 9 : precision, d);
+
+	g_cases ++;
+	if(strcmp(ours, ref) != 0)
+	{
+		g_failures ++;
+		if(g_failures < 20)
+			printf("FAIL %-7s %llx: got \"%s\", glibc \"%s\"\n", fmt,
+				static_cast<unsigned long long>(value), ours, ref);
+	}
+}
+
+static void CheckAllFormats(uint64_t bits, int precision)
+{
+	CheckFormat("hk", static_cast<int>(static_cast<int16_t>(bits)), static_cast<int16_t>(bits), true, 8, precision);
+	CheckFormat("uhk", static_cast<int>(static_cast<uint16_t>(bits)), static_cast<uint16_t>(bits), false, 8,
+		precision);
+	CheckFormat("k", static_cast<int32_t>(bits), static_cast<int32_t>(bits), true, 16, precision);
+	CheckFormat("uk", static_cast<uint32_t>(bits), static_cast<uint32_t>(bits), false, 16, precision);
+	CheckFormat("lk", static_cast<int64_t>(bits), static_cast<int64_t>(bits), true, 32, precision);
+	CheckFormat("ulk", bits, static_cast<int64_t>(bits), false, 32, precision);
+}
+
+static void CheckAllArithmetic(uint64_t a, uint64_t b)
+{
+	CheckArithmetic<fix8_8_t>("fix8_8", a, b);
+	CheckArithmetic<ufix8_8_t>("ufix8_8", a, b);
+	CheckArithmetic<fix16_16_t>("fix16_16", a, b);
+	CheckArithmetic<ufix16_16_t>("ufix16_16", a, b);
+	CheckArithmetic<fix32_32_t>("fix32_32", a, b);
+	CheckArithmetic<ufix32_32_t>("ufix32_32", a, b);
+}
+
+/**
+	@brief Random raw value with a random number of significant bits, so small magnitudes are well covered
+ */
+static uint64_t RandomRaw(TestRandom& rng)
+{
+	uint64_t v = rng.Next() >> rng.Below(64);
+	if(rng.Next() & 1)
+		v = -v;
+	return v;
+}
+
+int main(int argc, char* argv[])
+{
+	uint32_t count = 100000;
+	if(argc > 1)
+		count = strtoul(argv[1], nullptr, 0);
+
+	//Edge cases: zero, one, halves (ties when formatting), the extremes of each format
+	static const uint64_t edges[] =
+	{
+		0, 1, 2, 0x80, 0x100, 0x180, 0x8000, 0x10000, 0x18000, 0x7fff, 0xffff, 0x80000000, 0x100000000ULL,
+		0x180000000ULL, 0x7fffffff, 0xffffffff, 0x7fffffffffffffffULL, 0x8000000000000000ULL,
+		-1ULL, -2ULL, -0x80ULL, -0x8000ULL, -0x80000000ULL, -0x100000000ULL
+	};
+	for(auto a : edges)
+	{
+		for(auto b : edges)
+			CheckAllArithmetic(a, b);
+		for(int precision=0; precision<=12; precision++)
+			CheckAllFormats(a, precision);
+	}
+
+	//Exact conversions between formats
+	g_cases += 2;
+	if(fix16_16_t::FromDouble(-1.25).Convert<int64_t, 32>() != fix32_32_t::FromDouble(-1.25))
+		Fail("Convert widen", 0, 0, 0, 0);
+	if(fix32_32_t::FromDouble(-1.25).Convert<int16_t, 8>() != fix8_8_t::FromDouble(-1.25))
+		Fail("Convert narrow", 0, 0, 0, 0);
+
+	TestRandom rng;
+	for(uint32_t i=0; i<count; i++)
+	{
+		CheckAllArithmetic(RandomRaw(rng), RandomRaw(rng));
+		CheckAllFormats(RandomRaw(rng), rng.Below(13));
+	}
+
+	printf("%llu cases, %llu failures\n",
+		static_cast<unsigned long long>(g_cases), static_cast<unsigned long long>(g_failures));
+	return g_failures ? 1 : 0;
+}
@@ -0,0 +1,355 @@
+/***********************************************************************************************************************
+*                                                                                                                      *
+* embedded-utils                                                                                                       *
+*                                                                                                                      *
+* Copyright (c) 2020-2025 Andrew D. Zonenberg                                                                          *
+* All rights reserved.                                                                                                 *
+*                                                                                                                      *
+* Redistribution and use in source and binary forms, with or without modification, are permitted provided that the     *
+* following conditions are met:                                                                                        *
+*                                                                                                                      *
+*    * Redistributions of source code must retain the above copyright notice, this list of conditions, and the         *
+*      following disclaimer.                                                                                           *
+*                                                                                                                      *
+*    * Redistributions in binary form must reproduce the above copyright notice, this list of conditions and the       *
+*      following disclaimer in the documentation and/or other materials provided with the distribution.                *
+*                                                                                                                      *
+*    * Neither the name of the author nor the names of any contributors may be used to endorse or promote products     *
+*      derived from this software without specific prior written permission.                                           *
+*                                                                                                                      *
+* THIS SOFTWARE IS PROVIDED BY THE AUTHORS "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED   *
+* TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL *
+* THE AUTHORS BE HELD LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES        *
+* (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR       *
+* BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT *
+* (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE       *
+* POSSIBILITY OF SUCH DAMAGE.                                                                                          *
+*                                                                                                                      *
+***********************************************************************************************************************/
+
+/**
+	@file
+	@brief Power loss and program failure test of FlashLogStore on a simulated NOR flash
+
+	The simulated flash can only clear bits when programming, and reports any program that would need to set one,
+	i.e. writing over data that wasn't erased. It keeps its own record of every page programmed successfully, which is
+	exactly what a dump after a reboot must return.
+
+	Programs fail at random, leaving part or none of the page programmed, and the empty header FlashLogStore writes
+	over a failed page sometimes fails too, leaving a hole with no valid header. Power is cut at random in the middle of a
+	program, leaving a torn last page, and the store is then rebuilt from flash as at boot. Pass a boot count on the
+	command line to run more or fewer cases.
+ */
+
+#include <stdlib.h>
+#include <map>
+#include <string>
+#include <vector>
+
+#include "HostTest.h"
+#include "FlashLogStore.h"
+
+static uint64_t g_cases = 0;
+static uint64_t g_failures = 0;
+
+static void Check(bool ok, const char* what, uint32_t boot)
+{
+	g_cases ++;
+	if(!ok)
+	{
+		g_failures ++;
+		if(g_failures < 20)
+			printf("FAIL boot %u: %s\n", boot, what);
+	}
+}
+
+/**
+	@brief NOR flash with failure injection
+ */
+class SimFlash
+{
+public:
+	SimFlash(uint32_t size, uint32_t sectorSize, TestRandom& rng)
+	: m_mem(size, 0xff)
+	, m_sectorSize(sectorSize)
+	, m_rng(rng)
+	, m_failPercent(0)
+	, m_markFailPercent(0)
+	, m_failBlank(false)
+	, m_cutAfter(0)
+	, m_dead(false)
+	, m_overwrites(0)
+	, m_pagePrograms(0)
+	{}
+
+	void ReadData(uint32_t addr, uint8_t* data, uint32_t len)
+	{ memcpy(data, &m_mem[addr], len); }
+
+	bool WriteData(uint32_t addr, const uint8_t* data, uint32_t len)
+	{
+		if(m_dead)
+			return false;
+
+		//Power cut part way through a page program, before all of the header and data are done
+		bool page = (len == PAGE_SIZE);
+		uint16_t n = 0;
+		if(page)
+			memcpy(&n, data + 4, 2);
+		if(page && m_cutAfter && (--m_cutAfter == 0) )
+		{
+			Program(addr, data, m_rng.Below(8 + n));
+			m_pages.erase(addr);
+			m_dead = true;
+			return false;
+		}
+
+		//Failed program, leaving some of it done
+		if(page && (m_rng.Below(100) < m_failPercent) )
+		{
+			if(!m_failBlank)
+				Program(addr, data, m_rng.Below(8 + n));
+			m_pages.erase(addr);
+			return false;
+		}
+		if(!page && (m_rng.Below(100) < m_markFailPercent) )
+			return false;
+
+		Program(addr, data, len);
+		if(page)
+		{
+			m_pagePrograms ++;
+			uint32_t seq;
+			memcpy(&seq, data, 4);
+			m_pages[addr] = std::make_pair(seq, std::string(reinterpret_cast<const char*>(data) + 8, n));
+		}
+		return true;
+	}
+
+	bool EraseSector(uint32_t addr)
+	{
+		if(m_dead)
+			return false;
+		memset(&m_mem[addr], 0xff, m_sectorSize);
+		m_pages.erase(m_pages.lower_bound(addr), m_pages.lower_bound(addr + m_sectorSize));
+		return true;
+	}
+
+	uint32_t GetSectorSize()
+	{ return m_sectorSize; }
+
+	uint32_t GetMaxWriteBlockSize()
+	{ return PAGE_SIZE; }
+
+	///@brief Everything programmed successfully and not erased since, oldest first
+	std::string GetExpected()
+	{
+		std::map<uint32_t, const std::string*> bySeq;
+		for(auto& it : m_pages)
+			bySeq[it.second.first] = &it.second.second;
+		std::string ret;
+		for(auto& it : bySeq)
+			ret += *it.second;
+		return ret;
+	}
+
+	static const uint32_t PAGE_SIZE = 256;
+
+	std::vector<uint8_t> m_mem;
+	uint32_t m_sectorSize;
+	TestRandom& m_rng;
+
+	uint32_t m_failPercent;
+	uint32_t m_markFailPercent;
+
+	///@brief Make failed programs leave the page blank, rather than partly programmed
+	bool m_failBlank;
+
+	///@brief Number of page programs until the power is cut, or zero for never
+	uint32_t m_cutAfter;
+	bool m_dead;
+
+	///@brief Number of programs which needed a bit set, i.e. wrote over data that wasn't erased
+	uint32_t m_overwrites;
+
+	///@brief Number of pages programmed successfully
+	uint32_t m_pagePrograms;
+
+	///@brief Sequence number and data of each page programmed successfully, by address
+	std::map<uint32_t, std::pair<uint32_t, std::string> > m_pages;
+
+protected:
+	void Program(uint32_t addr, const uint8_t* data, uint32_t len)
+	{
+		for(uint32_t i=0; i<len; i++)
+		{
+			if( (m_mem[addr + i] & data[i]) != data[i])
+				m_overwrites ++;
+			m_mem[addr + i] &= data[i];
+		}
+	}
+};
+
+class StringDevice : public CharacterDevice
+{
+public:
+	virtual void PrintBinary(char ch) override
+	{ m_text += ch; }
+
+	virtual void Write(const char* data, uint32_t len) override
+	{ m_text.append(data, len); }
+
+	virtual char BlockingRead() override
+	{ return 0; }
+
+	std::string m_text;
+};
+
+typedef FlashLogStore<SimFlash, SimFlash::PAGE_SIZE> Store;
+
+/**
+	@brief Boots a store from flash and checks its dump against everything programmed, leaving it ready to write to
+
+	@return False if the store couldn't be initialized
+ */
+static bool Boot(Store& store, SimFlash& flash, uint32_t base, uint32_t size, uint32_t boot)
+{
+	flash.m_dead = false;
+	flash.m_cutAfter = 0;
+	std::string expected = flash.GetExpected();
+	bool ok = store.Initialize(base, size);
+	Check(ok, "Initialize failed", boot);
+
+	//Nothing may be lost by booting, e.g. by erasing newer pages after finding the wrong head
+	StringDevice dump;
+	store.Dump(&dump);
+	Check(dump.m_text == expected, "dump doesn't match what was programmed", boot);
+	return ok;
+}
+
+static void WriteLines(Store& store, TestRandom& rng, uint32_t& line, uint32_t count)
+{
+	for(uint32_t i=0; i<count; i++)
+	{
+		char buf[64];
+		int len = snprintf(buf, sizeof(buf), "line %08u %.*s\n", line++, static_cast<int>(rng.Below(40)),
+			"........................................");
+		store.Write(buf, len);
+		if(rng.Below(50) == 0)
+			store.Flush();
+	}
+}
+
+/**
+	@brief A failed program with no header in the middle of the log, then a torn last page
+ */
+static void TestHoleAndTornPage(uint32_t pagesPerSector, uint32_t holePage, uint32_t boot)
+{
+	TestRandom rng(holePage);
+	const uint32_t sectorSize = pagesPerSector * SimFlash::PAGE_SIZE;
+	const uint32_t size = 8 * sectorSize;
+	SimFlash flash(size, sectorSize, rng);
+	uint32_t line = 0;
+
+	Store store(flash);
+	Boot(store, flash, 0, size, boot);
+
+	//Fill up to just before the hole, fail it leaving it blank, then carry on for most of a lap
+	while(flash.m_pagePrograms < holePage)
+		WriteLines(store, rng, line, 1);
+	flash.m_failPercent = 100;
+	flash.m_markFailPercent = 100;
+	flash.m_failBlank = true;
+	while(store.GetFailedPages() == 0)
+		WriteLines(store, rng, line, 1);
+	flash.m_failPercent = 0;
+	flash.m_markFailPercent = 0;
+	flash.m_failBlank = false;
+	uint32_t end = flash.m_pagePrograms + 1 + rng.Below(6 * pagesPerSector);
+	while(flash.m_pagePrograms < end)
+		WriteLines(store, rng, line, 1);
+
+	//Tear the next page, or the retry of a blank failed one
+	flash.m_cutAfter = 1;
+	if(holePage & 1)
+	{
+		flash.m_cutAfter = 2;
+		flash.m_failPercent = 100;
+		flash.m_markFailPercent = 100;
+		flash.m_failBlank = true;
+	}
+	while(!flash.m_dead)
+		WriteLines(store, rng, line, 1);
+	flash.m_failPercent = 0;
+	flash.m_markFailPercent = 0;
+	flash.m_failBlank = false;
+
+	Store rebooted(flash);
+	Boot(rebooted, flash, 0, size, boot);
+	WriteLines(rebooted, rng, line, 200);
+	rebooted.Flush();
+	Check(flash.m_overwrites == 0, "programmed over data that wasn't erased", boot);
+
+	Store again(flash);
+	Boot(again, flash, 0, size, boot);
+}
+
+/**
+	@brief Random failures and power cuts over many boots
+ */
+static void TestRandomFailures(uint32_t pagesPerSector, uint32_t boots)
+{
+	TestRandom rng(pagesPerSector);
+	const uint32_t sectorSize = pagesPerSector * SimFlash::PAGE_SIZE;
+	const uint32_t base = 2 * sectorSize;
+	const uint32_t size = 8 * sectorSize;
+	SimFlash flash(base + size + sectorSize, sectorSize, rng);
+	uint32_t line = 0;
+
+	for(uint32_t boot=0; boot<boots; boot++)
+	{
+		Store store(flash);
+		if(!Boot(store, flash, base, size, boot))
+			return;
+
+		flash.m_failPercent = rng.Below(4) ? 0 : rng.Below(30);
+		flash.m_markFailPercent = rng.Below(2) ? 0 : 50;
+		flash.m_failBlank = rng.Below(2);
+		if(rng.Below(2))
+			flash.m_cutAfter = 1 + rng.Below(3 * pagesPerSector);
+		WriteLines(store, rng, line, rng.Below(30 * pagesPerSector));
+		if(rng.Below(2))
+			store.Flush();
+		flash.m_failPercent = 0;
+		flash.m_markFailPercent = 0;
+
+		Check(flash.m_overwrites == 0, "programmed over data that wasn't erased", boot);
+	}
+
+	//Nothing outside the region was touched
+	bool clean = true;
+	for(uint32_t i=0; i<base; i++)
+		clean &= (flash.m_mem[i] == 0xff);
+	for(uint32_t i=base + size; i<flash.m_mem.size(); i++)
+		clean &= (flash.m_mem[i] == 0xff);
+	Check(clean, "wrote outside the region", boots);
+}
+
+int main(int argc, char* argv[])
+{
+	uint32_t boots = 5000;
+	if(argc > 1)
+		boots = strtoul(argv[1], nullptr, 0);
+
+	//Holes at every position of the first two laps, with small and large sectors
+	for(uint32_t hole=1; hole<64; hole++)
+		TestHoleAndTornPage(4, hole, hole);
+	for(uint32_t hole=1; hole<256; hole += 7)
+		TestHoleAndTornPage(16, hole, hole);
+
+	TestRandomFailures(4, boots);
+	TestRandomFailures(16, boots);
+
+	printf("%llu cases, %llu failures\n",
+		static_cast<unsigned long long>(g_cases), static_cast<unsigned long long>(g_failures));
+	return g_failures ? 1 : 0;
+}
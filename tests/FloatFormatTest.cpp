@@ -0,0 +1,198 @@
+/***********************************************************************************************************************
+*                                                                                                                      *
+* embedded-utils                                                                                                       *
+*                                                                                                                      *
+* Copyright (c) 2020-2025 Andrew D. Zonenberg                                                                          *
+* All rights reserved.                                                                                                 *
+*                                                                                                                      *
+* Redistribution and use in source and binary forms, with or without modification, are permitted provided that the     *
+* following conditions are met:                                                                                        *
+*                                                                                                                      *
+*    * Redistributions of source code must retain the above copyright notice, this list of conditions, and the         *
+*      following disclaimer.                                                                                           *
+*                                                                                                                      *
+*    * Redistributions in binary form must reproduce the above copyright notice, this list of conditions and the       *
+*      following disclaimer in the documentation and/or other materials provided with the distribution.                *
+*                                                                                                                      *
+*    * Neither the name of the author nor the names of any contributors may be used to endorse or promote products     *
+*      derived from this software without specific prior written permission.                                           *
+*                                                                                                                      *
+* THIS SOFTWARE IS PROVIDED BY THE AUTHORS "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED   *
+* TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL *
+* THE AUTHORS BE HELD LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES        *
+* (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR       *
+* BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT *
+* (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE       *
+* POSSIBILITY OF SUCH DAMAGE.                                                                                          *
+*                                                                                                                      *
+***********************************************************************************************************************/
+
+/**
+	@file
+	@brief Differential test of DoPrintf %f / %e against glibc snprintf
+
+	Covers precisions 0-17 for both styles, over random bit patterns, random values of everyday magnitude, exact
+	decimal ties and the usual edge cases. Pass a value count on the command line to run more or fewer cases.
+
+	Also checks field width and flag handling, which is shared with the integer and hex conversions.
+ */
+
+#include <stdlib.h>
+#include <math.h>
+#include <float.h>
+
+#include "HostTest.h"
+
+static uint64_t g_cases = 0;
+static uint64_t g_failures = 0;
+
+/**
+	@brief Checks one value at one precision in both styles
+ */
+static void Check(double value, int precision)
+{
+	char ours[64];
+	char ref[64];
+	char fmt[16];
+
+	//%e always matches glibc
+	snprintf(fmt, sizeof(fmt), "%%.%de", precision);
+	TestFormat(ours, sizeof(ours), fmt, value);
+	snprintf(ref, sizeof(ref), fmt, value);
+	g_cases ++;
+	if(strcmp(ours, ref) != 0)
+	{
+		g_failures ++;
+		if(g_failures < 20)
+			printf("FAIL %-8s %a: got \"%s\", glibc \"%s\"\n", fmt, value, ours, ref);
+	}
+
+	//%f switches to %e style once the scaled value won't fit in 63 bits (documented limit).
+	//Skip the values close enough to that boundary for either style to be right.
+	snprintf(fmt, sizeof(fmt), "%%.%df", precision);
+	double scaled = fabs(value) * pow(10, precision);
+	if(isfinite(value) && (scaled >= 4e18) )
+	{
+		if(scaled < 1e19)
+			return;
+		snprintf(fmt, sizeof(fmt), "%%.%de", precision);
+		snprintf(ref, sizeof(ref), fmt, value);
+		snprintf(fmt, sizeof(fmt), "%%.%df", precision);
+	}
+	else
+		snprintf(ref, sizeof(ref), fmt, value);
+	TestFormat(ours, sizeof(ours), fmt, value);
+	g_cases ++;
+	if(strcmp(ours, ref) != 0)
+	{
+		g_failures ++;
+		if(g_failures < 20)
+			printf("FAIL %-8s %a: got \"%s\", glibc \"%s\"\n", fmt, value, ours, ref);
+	}
+}
+
+/**
+	@brief Checks one conversion of one value, including its field width and flags
+ */
+template<class T>
+static void CheckField(const char* fmt, T value)
+{
+	char ours[64];
+	char ref[64];
+	TestFormat(ours, sizeof(ours), fmt, value);
+	snprintf(ref, sizeof(ref), fmt, value);
+	g_cases ++;
+	if(strcmp(ours, ref) != 0)
+	{
+		g_failures ++;
+		if(g_failures < 20)
+			printf("FAIL %-8s: got \"%s\", glibc \"%s\"\n", fmt, ours, ref);
+	}
+}
+
+static void CheckFields()
+{
+	//Zero padding after the sign, and none at all when left justified
+	static const char* const hexFormats[] = { "%x", "%8x", "%08x", "%-8x", "%-08x", "%-08X", "%02x" };
+	static const char* const intFormats[] = { "%d", "%8d", "%08d", "%-8d", "%-08d", "%02d" };
+	static const char* const floatFormats[] = { "%.3f", "%12.3f", "%012.3f", "%-12.3f", "%-012.3f", "%-012.2e" };
+
+	static const int ints[] = { 0, 1, -1, 42, -42, 0x7fffffff, -0x7fffffff - 1 };
+	static const double floats[] = { 0.0, -0.0, 1.5, -1.5, 12345.678, -0.001, INFINITY, -INFINITY };
+
+	for(auto fmt : hexFormats)
+	{
+		for(auto i : ints)
+			CheckField(fmt, static_cast<unsigned int>(i));
+	}
+	for(auto fmt : intFormats)
+	{
+		for(auto i : ints)
+			CheckField(fmt, i);
+	}
+	for(auto fmt : floatFormats)
+	{
+		for(auto d : floats)
+			CheckField(fmt, d);
+	}
+}
+
+static void CheckAllPrecisions(double value)
+{
+	for(int precision=0; precision<=17; precision++)
+		Check(value, precision);
+}
+
+int main(int argc, char* argv[])
+{
+	uint32_t count = 100000;
+	if(argc > 1)
+		count = strtoul(argv[1], nullptr, 0);
+
+	CheckFields();
+
+	//Edge cases
+	static const double edges[] =
+	{
+		0.0, -0.0, 1.0, -1.0, 0.5, 1.5, 2.5, -2.5, 0.125, 0.375, 9.5, 99.5, 0.05, 0.95, 9.9999995, 1e15 + 0.5,
+		123456789.0, 4503599627370495.5, 9007199254740993.0, 1e-5, 1e-7, 1e-17, 1e-18, 1e22, 1e23,
+		DBL_MIN, -DBL_MIN, DBL_MAX, -DBL_MAX, DBL_TRUE_MIN, -DBL_TRUE_MIN, INFINITY, -INFINITY, NAN
+	};
+	for(auto d : edges)
+		CheckAllPrecisions(d);
+
+	TestRandom rng;
+	for(uint32_t i=0; i<count; i++)
+	{
+		uint64_t bits;
+		double d;
+		switch(i % 3)
+		{
+			//Any finite double
+			case 0:
+				do
+				{
+					bits = rng.Next();
+					memcpy(&d, &bits, sizeof(d));
+				} while(!isfinite(d));
+				break;
+
+			//Everyday magnitudes, 1e-9 to 1e12
+			case 1:
+				d = ldexp(static_cast<double>(rng.Next() >> 11), -53) * pow(10, static_cast<int>(rng.Below(22)) - 9);
+				if(rng.Next() & 1)
+					d = -d;
+				break;
+
+			//Exact ties at some precision: odd multiples of 2^-n are exactly halfway between decimals
+			default:
+				d = ldexp(static_cast<double>( (rng.Next() >> 40) | 1), -static_cast<int>(rng.Below(30)));
+				break;
+		}
+		CheckAllPrecisions(d);
+	}
+
+	printf("%llu cases, %llu failures\n",
+		static_cast<unsigned long long>(g_cases), static_cast<unsigned long long>(g_failures));
+	return g_failures ? 1 : 0;
+}
@@ -0,0 +1,140 @@
+/***********************************************************************************************************************
+*                                                                                                                      *
+* embedded-utils                                                                                                       *
+*                                                                                                                      *
+* Copyright (c) 2020-2025 Andrew D. Zonenberg                                                                          *
+* All rights reserved.                                                                                                 *
+*                                                                                                                      *
+* Redistribution and use in source and binary forms, with or without modification, are permitted provided that the     *
+* following conditions are met:                                                                                        *
+*                                                                                                                      *
+*    * Redistributions of source code must retain the above copyright notice, this list of conditions, and the         *
+*      following disclaimer.                                                                                           *
+*                                                                                                                      *
+*    * Redistributions in binary form must reproduce the above copyright notice, this list of conditions and the       *
+*      following disclaimer in the documentation and/or other materials provided with the distribution.                *
+*                                                                                                                      *
+*    * Neither the name of the author nor the names of any contributors may be used to endorse or promote products     *
+*      derived from this software without specific prior written permission.                                           *
+*                                                                                                                      *
+* THIS SOFTWARE IS PROVIDED BY THE AUTHORS "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED   *
+* TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL *
+* THE AUTHORS BE HELD LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES        *
+* (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR       *
+* BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT *
+* (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE       *
+* POSSIBILITY OF SUCH DAMAGE.                                                                                          *
+*                                                                                                                      *
+***********************************************************************************************************************/
+
+/**
+	@file
+	@brief Test of the MonotonicClock counter extension against a fake timer of known true count
+
+	Built without SIMULATION so the real cnt32_to_63 style extension is used. For 16, 24 and 32-bit counters, the true
+	count is advanced by random steps of up to half the wrap period, and every read must return it exactly. Some reads
+	are "interrupted" just after sampling the counter by a later read, which may move the high word on before the
+	first reader finishes. That is what the lock free update has to survive. Pass a step count on the command line to
+	run more or fewer cases.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+
+#include <APB_Timer.h>
+#include "MonotonicClock.h"
+#include "TestRandom.h"
+
+static uint64_t g_cases = 0;
+static uint64_t g_failures = 0;
+
+static Timer* g_timer;
+static MonotonicClock* g_clock;
+static uint64_t g_nestedStep;
+static uint64_t g_nestedTicks;
+
+///@brief Reads the clock from "interrupt context" some time later, i.e. from inside another reader's timer access
+static void NestedRead()
+{
+	g_timer->m_onRead = nullptr;
+	g_timer->m_count += g_nestedStep;
+	g_nestedTicks = g_clock->GetTicks();
+}
+
+static void Check(const char* what, uint32_t bits, uint64_t got, uint64_t expected)
+{
+	g_cases ++;
+	if(got != expected)
+	{
+		g_failures ++;
+		if(g_failures < 20)
+		{
+			printf("FAIL %u-bit %s: got %llx, expected %llx\n", bits, what,
+				static_cast<unsigned long long>(got), static_cast<unsigned long long>(expected));
+		}
+	}
+}
+
+static void TestWidth(uint32_t bits, uint32_t steps)
+{
+	Timer timer(bits);
+	MonotonicClock clock;
+	clock.Initialize(&timer, 10000, bits);
+	g_timer = &timer;
+	g_clock = &clock;
+
+	uint64_t half = 1ULL << (bits - 1);
+	TestRandom rng(bits);
+	for(uint32_t i=0; i<steps; i++)
+	{
+		//Mostly small steps, sometimes right up to the half period limit
+		uint64_t step;
+		switch(rng.Below(4))
+		{
+			case 0:
+				step = half - 1;
+				break;
+
+			case 1:
+				step = rng.Next() % half;
+				break;
+
+			default:
+				step = rng.Below(1000);
+				break;
+		}
+		timer.m_count += step;
+
+		//Sometimes an interrupt reads the clock later, while this reader is between sampling the counter and
+		//returning. Both steps together must stay within half a wrap of the last read.
+		if(rng.Below(8) == 0)
+		{
+			uint64_t before = timer.m_count;
+			g_nestedStep = rng.Next() % (half - step);
+			timer.m_onRead = NestedRead;
+			uint64_t ticks = clock.GetTicks();
+			Check("nested read", bits, g_nestedTicks, timer.m_count);
+			Check("preempted read", bits, ticks, before);
+		}
+		else
+			Check("read", bits, clock.GetTicks(), timer.m_count);
+	}
+
+	//Microsecond conversion at 10 kHz
+	Check("microseconds", bits, clock.GetMicroseconds(), timer.m_count * 100);
+}
+
+int main(int argc, char* argv[])
+{
+	uint32_t steps = 1000000;
+	if(argc > 1)
+		steps = strtoul(argv[1], nullptr, 0);
+
+	TestWidth(16, steps);
+	TestWidth(24, steps);
+	TestWidth(32, steps);
+
+	printf("%llu cases, %llu failures\n",
+		static_cast<unsigned long long>(g_cases), static_cast<unsigned long long>(g_failures));
+	return g_failures ? 1 : 0;
+}
@@ -0,0 +1,299 @@
+/***********************************************************************************************************************
+*                                                                                                                      *
+* embedded-utils                                                                                                       *
+*                                                                                                                      *
+* Copyright (c) 2020-2025 Andrew D. Zonenberg                                                                          *
+* All rights reserved.                                                                                                 *
+*                                                                                                                      *
+* Redistribution and use in source and binary forms, with or without modification, are permitted provided that the     *
+* following conditions are met:                                                                                        *
+*                                                                                                                      *
+*    * Redistributions of source code must retain the above copyright notice, this list of conditions, and the         *
+*      following disclaimer.                                                                                           *
+*                                                                                                                      *
+*    * Redistributions in binary form must reproduce the above copyright notice, this list of conditions and the       *
+*      following disclaimer in the documentation and/or other materials provided with the distribution.                *
+*                                                                                                                      *
+*    * Neither the name of the author nor the names of any contributors may be used to endorse or promote products     *
+*      derived from this software without specific prior written permission.                                           *
+*                                                                                                                      *
+* THIS SOFTWARE IS PROVIDED BY THE AUTHORS "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED   *
+* TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL *
+* THE AUTHORS BE HELD LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES        *
+* (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR       *
+* BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT *
+* (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE       *
+* POSSIBILITY OF SUCH DAMAGE.                                                                                          *
+*                                                                                                                      *
+***********************************************************************************************************************/
+
+/**
+	@file
+	@brief Throughput benchmark and differential check of DoPrintf against glibc snprintf
+
+	Formats a corpus of typical log lines into a StringBuffer, into a NullCharacterDevice and with glibc snprintf, and
+	reports ns/call and bytes/s for each. Before timing anything, every corpus line and a set of random integer and
+	string conversions are compared against glibc, so an optimization that changes the output fails the run.
+
+	Pass an iteration count on the command line to change the length of the timed runs.
+ */
+
+#include <stdlib.h>
+
+#include "HostTest.h"
+#include "NullCharacterDevice.h"
+
+static void Emit(CharacterDevice* target, const char* format, ...)
+{
+	va_list list;
+	va_start(list, format);
+	DoPrintf(target, format, list);
+	va_end(list);
+}
+
+static const char* const g_names[] = { "eth0", "sfp1", "mgmt", "xg3" };
+
+/**
+	@brief One corpus line: our format, and the same output from glibc
+
+	Arguments are derived from the iteration number so each call formats different values. Our %uhk (unsigned 8.8
+	fixed point) has no glibc equivalent, so the glibc side prints the same value with %.3f.
+ */
+struct CorpusLine
+{
+	const char* name;
+	void (*ours)(CharacterDevice* target, uint32_t i);
+	int (*glibc)(char* buf, size_t size, uint32_t i);
+};
+
+static const CorpusLine g_corpus[] =
+{
+	{
+		"link",
+		[](CharacterDevice* t, uint32_t i)
+		{ Emit(t, "Link up at %d Mbps, %s duplex", 10 << (i % 4), (i & 1) ? "full" : "half"); },
+		[](char* b, size_t n, uint32_t i)
+		{ return snprintf(b, n, "Link up at %d Mbps, %s duplex", 10 << (i % 4), (i & 1) ? "full" : "half"); }
+	},
+	{
+		"register",
+		[](CharacterDevice* t, uint32_t i)
+		{ Emit(t, "Read %08x from register %08x", i * 2654435761u, 0x40020000 + (i & 0xff) * 4); },
+		[](char* b, size_t n, uint32_t i)
+		{ return snprintf(b, n, "Read %08x from register %08x", i * 2654435761u, 0x40020000 + (i & 0xff) * 4); }
+	},
+	{
+		"temperature",
+		[](CharacterDevice* t, uint32_t i)
+		{ Emit(t, "Die temperature: %uhk C", (i * 37) & 0xffff); },
+		[](char* b, size_t n, uint32_t i)
+		{ return snprintf(b, n, "Die temperature: %.3f C", ( (i * 37) & 0xffff) / 256.0); }
+	},
+	{
+		"counters",
+		[](CharacterDevice* t, uint32_t i)
+		{ Emit(t, "[%s] %d packets, %d errors, %d dropped", g_names[i % 4], i * 1013, i % 17, -(int)(i % 5)); },
+		[](char* b, size_t n, uint32_t i)
+		{
+			return snprintf(b, n, "[%s] %d packets, %d errors, %d dropped",
+				g_names[i % 4], i * 1013, i % 17, -(int)(i % 5));
+		}
+	},
+	{
+		"flash",
+		[](CharacterDevice* t, uint32_t i)
+		{ Emit(t, "Flash sector %d erased in %d ms, status %02x", i % 64, 20 + i % 400, i & 0xff); },
+		[](char* b, size_t n, uint32_t i)
+		{ return snprintf(b, n, "Flash sector %d erased in %d ms, status %02x", i % 64, 20 + i % 400, i & 0xff); }
+	},
+	{
+		"address",
+		[](CharacterDevice* t, uint32_t i)
+		{ Emit(t, "IP address %d.%d.%d.%d/%d", 10, (i >> 16) & 0xff, (i >> 8) & 0xff, i & 0xff, 8 + i % 24); },
+		[](char* b, size_t n, uint32_t i)
+		{
+			return snprintf(b, n, "IP address %d.%d.%d.%d/%d",
+				10, (i >> 16) & 0xff, (i >> 8) & 0xff, i & 0xff, 8 + i % 24);
+		}
+	},
+	{
+		"rail",
+		[](CharacterDevice* t, uint32_t i)
+		{ Emit(t, "Rail %-6s %uhk V (%5d mV nominal)", g_names[i % 4], 0x300 + i % 0x200, 3300); },
+		[](char* b, size_t n, uint32_t i)
+		{ return snprintf(b, n, "Rail %-6s %.3f V (%5d mV nominal)", g_names[i % 4], (0x300 + i % 0x200) / 256.0, 3300); }
+	},
+};
+static const uint32_t g_corpusSize = sizeof(g_corpus) / sizeof(g_corpus[0]);
+
+static uint64_t g_cases = 0;
+static uint64_t g_failures = 0;
+
+static void Compare(const char* what, const char* ours, const char* ref)
+{
+	g_cases ++;
+	if(strcmp(ours, ref) == 0)
+		return;
+	g_failures ++;
+	if(g_failures < 20)
+		printf("FAIL %s: got \"%s\", glibc \"%s\"\n", what, ours, ref);
+}
+
+/**
+	@brief Checks every corpus line, and that NullCharacterDevice counts the same number of bytes
+ */
+static void CheckCorpus()
+{
+	char ours[256];
+	char ref[256];
+	for(uint32_t line=0; line<g_corpusSize; line++)
+	{
+		auto& c = g_corpus[line];
+		for(uint32_t i=0; i<20000; i++)
+		{
+			StringBuffer sb(ours, sizeof(ours));
+			c.ours(&sb, i);
+			c.glibc(ref, sizeof(ref), i);
+			Compare(c.name, sb.c_str(), ref);
+
+			NullCharacterDevice null;
+			c.ours(&null, i);
+			g_cases ++;
+			if(null.length() != sb.length())
+			{
+				g_failures ++;
+				printf("FAIL %s: NullCharacterDevice counted %zu bytes, StringBuffer has %zu\n",
+					c.name, null.length(), sb.length());
+			}
+		}
+	}
+}
+
+/**
+	@brief Random integer, hex, char and string conversions with assorted widths
+ */
+static void CheckConversions()
+{
+	static const char* const intFormats[] =
+	{
+		"%d", "%u", "%x", "%X", "%08x", "%2x", "%5d", "%-6d|", "%012d", "%c", "%%%d%%"
+	};
+	static const char* const wideFormats[] = { "%lld", "%llu", "%llx", "%016llx", "%20lld" };
+	static const char* const stringFormats[] = { "%s", "%10s", "%-10s|", "<%3s>" };
+	static const char* const strings[] = { "", "a", "hello", "a longer string than the field" };
+
+	char ours[128];
+	char ref[128];
+	TestRandom rng;
+	for(uint32_t i=0; i<200000; i++)
+	{
+		//Mix small values with full range ones so both short and long outputs are covered
+		uint64_t r = rng.Next();
+		uint32_t n = (i & 1) ? static_cast<uint32_t>(r) : static_cast<uint32_t>(r % 1000);
+
+		for(auto f : intFormats)
+		{
+			//%c with 0 would end the string early on both sides
+			uint32_t arg = (f[1] == 'c') ? (32 + n % 95) : n;
+			Compare(f, TestFormat(ours, sizeof(ours), f, arg), (snprintf(ref, sizeof(ref), f, arg), ref));
+		}
+
+		int64_t w = (i & 2) ? static_cast<int64_t>(r) : static_cast<int64_t>(r % 100000) - 50000;
+		for(auto f : wideFormats)
+			Compare(f, TestFormat(ours, sizeof(ours), f, w), (snprintf(ref, sizeof(ref), f, w), ref));
+
+		if(i < 1000)
+		{
+			auto s = strings[i % 4];
+			for(auto f : stringFormats)
+				Compare(f, TestFormat(ours, sizeof(ours), f, s), (snprintf(ref, sizeof(ref), f, s), ref));
+		}
+	}
+}
+
+/**
+	@brief Prints one result line
+
+	@param ns		Total time for the run
+	@param calls	Number of lines formatted
+	@param bytes	Number of bytes produced
+ */
+static void Report(const char* what, uint64_t ns, uint64_t calls, uint64_t bytes)
+{
+	printf("%-32s %8.1f ns/call %9.1f MB/s\n", what, double(ns) / calls, bytes * 1e3 / ns);
+}
+
+static void Benchmark(uint32_t iterations)
+{
+	char buf[256];
+	uint64_t calls = static_cast<uint64_t>(iterations) * g_corpusSize;
+
+	//Our formatter into a StringBuffer
+	uint64_t bytes = 0;
+	uint64_t start = TestNanoseconds();
+	for(uint32_t i=0; i<iterations; i++)
+	{
+		for(auto& c : g_corpus)
+		{
+			StringBuffer sb(buf, sizeof(buf));
+			c.ours(&sb, i);
+			bytes += sb.length();
+		}
+	}
+	Report("DoPrintf -> StringBuffer", TestNanoseconds() - start, calls, bytes);
+
+	//Our formatter into a null sink (formatting cost only)
+	NullCharacterDevice null;
+	start = TestNanoseconds();
+	for(uint32_t i=0; i<iterations; i++)
+	{
+		for(auto& c : g_corpus)
+			c.ours(&null, i);
+	}
+	Report("DoPrintf -> NullCharacterDevice", TestNanoseconds() - start, calls, null.length());
+
+	//glibc for comparison
+	bytes = 0;
+	start = TestNanoseconds();
+	for(uint32_t i=0; i<iterations; i++)
+	{
+		for(auto& c : g_corpus)
+			bytes += c.glibc(buf, sizeof(buf), i);
+	}
+	Report("glibc snprintf", TestNanoseconds() - start, calls, bytes);
+
+	//Per line breakdown
+	for(auto& c : g_corpus)
+	{
+		uint64_t ours = 0;
+		uint64_t theirs = 0;
+		NullCharacterDevice lineNull;
+		start = TestNanoseconds();
+		for(uint32_t i=0; i<iterations; i++)
+			c.ours(&lineNull, i);
+		ours = TestNanoseconds() - start;
+		start = TestNanoseconds();
+		for(uint32_t i=0; i<iterations; i++)
+			c.glibc(buf, sizeof(buf), i);
+		theirs = TestNanoseconds() - start;
+		printf("  %-12s %8.1f ns/call (glibc %8.1f)\n", c.name, double(ours) / iterations, double(theirs) / iterations);
+	}
+}
+
+int main(int argc, char* argv[])
+{
+	uint32_t iterations = 200000;
+	if(argc > 1)
+		iterations = strtoul(argv[1], nullptr, 0);
+
+	CheckCorpus();
+	CheckConversions();
+	printf("%llu differential cases, %llu failures\n",
+		static_cast<unsigned long long>(g_cases), static_cast<unsigned long long>(g_failures));
+	if(g_failures)
+		return 1;
+
+	if(iterations)
+		Benchmark(iterations);
+	return 0;
+}
@@ -0,0 +1,387 @@
+/***********************************************************************************************************************
+*                                                                                                                      *
+* embedded-utils                                                                                                       *
+*                                                                                                                      *
+* Copyright (c) 2020-2025 Andrew D. Zonenberg                                                                          *
+* All rights reserved.                                                                                                 *
+*                                                                                                                      *
+* Redistribution and use in source and binary forms, with or without modification, are permitted provided that the     *
+* following conditions are met:                                                                                        *
+*                                                                                                                      *
+*    * Redistributions of source code must retain the above copyright notice, this list of conditions, and the         *
+*      following disclaimer.                                                                                           *
+*                                                                                                                      *
+*    * Redistributions in binary form must reproduce the above copyright notice, this list of conditions and the       *
+*      following disclaimer in the documentation and/or other materials provided with the distribution.                *
+*                                                                                                                      *
+*    * Neither the name of the author nor the names of any contributors may be used to endorse or promote products     *
+*      derived from this software without specific prior written permission.                                           *
+*                                                                                                                      *
+* THIS SOFTWARE IS PROVIDED BY THE AUTHORS "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED   *
+* TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL *
+* THE AUTHORS BE HELD LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES        *
+* (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR       *
+* BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT *
+* (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE       *
+* POSSIBILITY OF SUCH DAMAGE.                                                                                          *
+*                                                                                                                      *
+***********************************************************************************************************************/
+
+/**
+	@file
+	@brief Benchmark and differential check of the word-at-a-time string helpers against libc
+
+	Checks FastStrlen, FastMemchr, ParseU32, ParseHex, ParseI64, StringView::Trim and StringTokenizer against libc
+	references on every alignment and a large set of random inputs, then times each against its libc counterpart.
+
+	Pass an iteration count on the command line to change the length of the timed runs.
+ */
+
+#include <stdlib.h>
+#include <errno.h>
+#include <ctype.h>
+
+#include "HostTest.h"
+#include "StringTokenizer.h"
+
+static uint64_t g_cases = 0;
+static uint64_t g_failures = 0;
+
+static void Expect(bool ok, const char* what, const char* str, size_t len)
+{
+	g_cases ++;
+	if(ok)
+		return;
+	g_failures ++;
+	if(g_failures < 20)
+		printf("FAIL %s: \"%.*s\"\n", what, static_cast<int>(len), str);
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// Strict libc based references for the parsers
+
+static bool AllOf(const char* str, size_t len, int (*pred)(int))
+{
+	for(size_t i=0; i<len; i++)
+	{
+		if(!pred(static_cast<unsigned char>(str[i])))
+			return false;
+	}
+	return true;
+}
+
+static bool RefU32(const char* str, size_t len, uint32_t& out)
+{
+	if( (len == 0) || !AllOf(str, len, isdigit) )
+		return false;
+	char tmp[64];
+	snprintf(tmp, sizeof(tmp), "%.*s", static_cast<int>(len), str);
+	errno = 0;
+	unsigned long long v = strtoull(tmp, nullptr, 10);
+	if( (errno != 0) || (v > 0xffffffff) )
+		return false;
+	out = v;
+	return true;
+}
+
+static bool RefHex(const char* str, size_t len, uint32_t& out)
+{
+	if( (len > 2) && (str[0] == '0') && ( (str[1] == 'x') || (str[1] == 'X') ) )
+	{
+		str += 2;
+		len -= 2;
+	}
+	if( (len == 0) || !AllOf(str, len, isxdigit) )
+		return false;
+	char tmp[64];
+	snprintf(tmp, sizeof(tmp), "%.*s", static_cast<int>(len), str);
+	errno = 0;
+	unsigned long long v = strtoull(tmp, nullptr, 16);
+	if( (errno != 0) || (v > 0xffffffff) )
+		return false;
+	out = v;
+	return true;
+}
+
+static bool RefI64(const char* str, size_t len, int64_t& out)
+{
+	size_t start = ( (len > 0) && ( (str[0] == '-') || (str[0] == '+') ) ) ? 1 : 0;
+	if( (len == start) || !AllOf(str + start, len - start, isdigit) )
+		return false;
+	char tmp[64];
+	snprintf(tmp, sizeof(tmp), "%.*s", static_cast<int>(len), str);
+	errno = 0;
+	long long v = strtoll(tmp, nullptr, 10);
+	if(errno != 0)
+		return false;
+	out = v;
+	return true;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// Differential checks
+
+static void CheckScanning()
+{
+	//Every length and alignment, with the terminator or target byte at every position
+	alignas(8) char buf[128];
+	for(size_t align=0; align<8; align++)
+	{
+		for(size_t len=0; len<64; len++)
+		{
+			memset(buf, 'a', sizeof(buf));
+			char* s = buf + align;
+			s[len] = '\0';
+			Expect(FastStrlen(s) == strlen(s), "FastStrlen", s, len);
+
+			//Byte with the high bit set, to catch sign extension in the pattern
+			memset(buf, 'a', sizeof(buf));
+			for(size_t pos=0; pos<=len; pos++)
+			{
+				if(pos < len)
+					s[pos] = '\xe9';
+				Expect(FastMemchr(s, '\xe9', len) == memchr(s, '\xe9', len), "FastMemchr", s, len);
+				Expect(FastMemchr(s, 'b', len) == nullptr, "FastMemchr absent", s, len);
+				if(pos < len)
+					s[pos] = 'a';
+			}
+		}
+	}
+}
+
+static void CheckParsers()
+{
+	static const char* const edges[] =
+	{
+		"", "0", "00000000000000000000001", "4294967295", "4294967296", "99999999999", "ffffffff", "0xffffffff",
+		"0x100000000", "0x", "0x0", "000000000ffffffff", "-", "+", "-0", "+12", "9223372036854775807",
+		"9223372036854775808", "-9223372036854775808", "-9223372036854775809", "18446744073709551616", "12a4",
+		" 12", "12 ", "1:", "/9"
+	};
+
+	TestRandom rng;
+	char str[40];
+	for(uint32_t i=0; i<2000000; i++)
+	{
+		size_t len;
+		if(i < sizeof(edges) / sizeof(edges[0]))
+		{
+			len = strlen(edges[i]);
+			memcpy(str, edges[i], len);
+		}
+		else
+		{
+			//Mostly digits or hex digits, sometimes with a sign, prefix or stray character
+			static const char digits[] = "0123456789abcdefABCDEF";
+			len = rng.Below(24);
+			bool hex = rng.Below(2);
+			for(size_t j=0; j<len; j++)
+				str[j] = digits[rng.Below(hex ? 22 : 10)];
+			uint32_t r = rng.Below(16);
+			if( (r == 0) && len)
+				str[0] = '-';
+			else if( (r == 1) && (len > 2) )
+			{
+				str[0] = '0';
+				str[1] = 'x';
+			}
+			else if( (r == 2) && len)
+				str[rng.Below(len)] = ":/ g\xb0"[rng.Below(5)];
+		}
+
+		uint32_t u = 0;
+		uint32_t ru = 0;
+		bool ok = ParseU32(str, len, u);
+		Expect( (ok == RefU32(str, len, ru)) && (!ok || (u == ru)), "ParseU32", str, len);
+
+		ok = ParseHex(str, len, u);
+		Expect( (ok == RefHex(str, len, ru)) && (!ok || (u == ru)), "ParseHex", str, len);
+
+		int64_t s = 0;
+		int64_t rs = 0;
+		ok = ParseI64(str, len, s);
+		Expect( (ok == RefI64(str, len, rs)) && (!ok || (s == rs)), "ParseI64", str, len);
+	}
+}
+
+static void CheckTokenizer()
+{
+	TestRandom rng;
+	for(uint32_t i=0; i<100000; i++)
+	{
+		//Random mix of words, separators and non-ASCII bytes (which must not count as whitespace)
+		char str[64];
+		size_t len = rng.Below(sizeof(str) - 1);
+		for(size_t j=0; j<len; j++)
+			str[j] = "ab \t\xa0\xe9"[rng.Below(6)];
+		str[len] = '\0';
+
+		char copy[64];
+		memcpy(copy, str, len + 1);
+		char* save = nullptr;
+		char* ref = strtok_r(copy, " ", &save);
+		StringTokenizer tok(StringView(str, len));
+		StringView token;
+		bool match = true;
+		while(tok.Next(token))
+		{
+			if(!ref || (token != ref) )
+				match = false;
+			ref = strtok_r(nullptr, " ", &save);
+		}
+		Expect(match && !ref, "StringTokenizer", str, len);
+
+		//Trim only strips the ASCII whitespace isspace() knows in the C locale
+		const char* start = str;
+		const char* end = str + len;
+		while( (start < end) && isspace(static_cast<unsigned char>(*start)) )
+			start ++;
+		while( (end > start) && isspace(static_cast<unsigned char>(end[-1])) )
+			end --;
+		auto trimmed = StringView(str, len).Trim();
+		Expect( (trimmed.data() == start) && (trimmed.length() == static_cast<size_t>(end - start)), "Trim", str, len);
+	}
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// Benchmarks
+
+//Keeps results live so the compiler can't drop the loops
+static volatile uint64_t g_sink;
+
+static void Report(const char* ours, uint64_t oursNs, const char* theirs, uint64_t theirsNs, uint64_t calls)
+{
+	printf("%-18s %7.1f ns/call    %-18s %7.1f ns/call\n",
+		ours, double(oursNs) / calls, theirs, double(theirsNs) / calls);
+}
+
+/**
+	@brief Times fn(i) for i in [0, iterations)
+ */
+template<class F>
+static uint64_t Time(uint32_t iterations, F fn)
+{
+	uint64_t acc = 0;
+	uint64_t start = TestNanoseconds();
+	for(uint32_t i=0; i<iterations; i++)
+		acc += fn(i);
+	uint64_t ns = TestNanoseconds() - start;
+	g_sink = acc;
+	return ns;
+}
+
+static void Benchmark(uint32_t iterations)
+{
+	//Typical CLI and config lines
+	static const char* const lines[] =
+	{
+		"set interface eth0 address 192.168.1.10 netmask 255.255.255.0",
+		"show",
+		"flash write 0x08020000 4096",
+		"   timeout = 1500   ",
+		"ssh key add ecdsa AAAAE2VjZHNhLXNoYTItbmlzdHAyNTYAAAAIbmlzdHAyNTYAAABBBPxq user@host",
+	};
+	const uint32_t nlines = sizeof(lines) / sizeof(lines[0]);
+	size_t lens[nlines];
+	for(uint32_t i=0; i<nlines; i++)
+		lens[i] = strlen(lines[i]);
+
+	printf("Scanning (%u lines, %zu-%zu bytes)\n", nlines, lens[1], lens[4]);
+	Report(
+		"FastStrlen", Time(iterations, [&](uint32_t i) { return FastStrlen(lines[i % nlines]); }),
+		"strlen", Time(iterations, [&](uint32_t i) { return strlen(lines[i % nlines]); }),
+		iterations);
+	Report(
+		"FastMemchr", Time(iterations, [&](uint32_t i)
+			{ return reinterpret_cast<uintptr_t>(FastMemchr(lines[i % nlines], '=', lens[i % nlines])); }),
+		"memchr", Time(iterations, [&](uint32_t i)
+			{ return reinterpret_cast<uintptr_t>(memchr(lines[i % nlines], '=', lens[i % nlines])); }),
+		iterations);
+
+	printf("Tokenizing\n");
+	Report(
+		"StringTokenizer", Time(iterations, [&](uint32_t i)
+			{
+				StringTokenizer tok(StringView(lines[i % nlines], lens[i % nlines]));
+				StringView token;
+				uint64_t n = 0;
+				while(tok.Next(token))
+					n += token.length();
+				return n;
+			}),
+		"memcpy + strtok_r", Time(iterations, [&](uint32_t i)
+			{
+				//strtok modifies its input, so it has to work on a copy
+				char copy[128];
+				memcpy(copy, lines[i % nlines], lens[i % nlines] + 1);
+				char* save = nullptr;
+				uint64_t n = 0;
+				for(char* p = strtok_r(copy, " ", &save); p; p = strtok_r(nullptr, " ", &save))
+					n += strlen(p);
+				return n;
+			}),
+		iterations);
+
+	//Numbers as they'd appear in a command, not null terminated in our case
+	static const char* const decimals[] = { "0", "42", "1500", "65535", "4096000", "4294967295" };
+	static const char* const hexes[] = { "0", "ff", "0x1000", "deadbeef", "0x08020000", "7fff" };
+	static const char* const signeds[] = { "-1", "1500", "-32768", "123456789012", "-9223372036854775807", "7" };
+	size_t dlens[6];
+	size_t hlens[6];
+	size_t slens[6];
+	for(int i=0; i<6; i++)
+	{
+		dlens[i] = strlen(decimals[i]);
+		hlens[i] = strlen(hexes[i]);
+		slens[i] = strlen(signeds[i]);
+	}
+
+	printf("Parsing\n");
+	Report(
+		"ParseU32", Time(iterations, [&](uint32_t i)
+			{
+				uint32_t v = 0;
+				ParseU32(decimals[i % 6], dlens[i % 6], v);
+				return v;
+			}),
+		"strtoul", Time(iterations, [&](uint32_t i) { return strtoul(decimals[i % 6], nullptr, 10); }),
+		iterations);
+	Report(
+		"ParseHex", Time(iterations, [&](uint32_t i)
+			{
+				uint32_t v = 0;
+				ParseHex(hexes[i % 6], hlens[i % 6], v);
+				return v;
+			}),
+		"strtoul(16)", Time(iterations, [&](uint32_t i) { return strtoul(hexes[i % 6], nullptr, 16); }),
+		iterations);
+	Report(
+		"ParseI64", Time(iterations, [&](uint32_t i)
+			{
+				int64_t v = 0;
+				ParseI64(signeds[i % 6], slens[i % 6], v);
+				return static_cast<uint64_t>(v);
+			}),
+		"strtoll", Time(iterations, [&](uint32_t i)
+			{ return static_cast<uint64_t>(strtoll(signeds[i % 6], nullptr, 10)); }),
+		iterations);
+}
+
+int main(int argc, char* argv[])
+{
+	uint32_t iterations = 5000000;
+	if(argc > 1)
+		iterations = strtoul(argv[1], nullptr, 0);
+
+	CheckScanning();
+	CheckParsers();
+	CheckTokenizer();
+	printf("%llu differential cases, %llu failures\n",
+		static_cast<unsigned long long>(g_cases), static_cast<unsigned long long>(g_failures));
+	if(g_failures)
+		return 1;
+
+	if(iterations)
+		Benchmark(iterations);
+	return 0;
+}
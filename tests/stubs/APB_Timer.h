@@ -0,0 +1,73 @@
+/***********************************************************************************************************************
+*                                                                                                                      *
+* embedded-utils                                                                                                       *
+*                                                                                                                      *
+* Copyright (c) 2020-2025 Andrew D. Zonenberg                                                                          *
+* All rights reserved.                                                                                                 *
+*                                                                                                                      *
+* Redistribution and use in source and binary forms, with or without modification, are permitted provided that the     *
+* following conditions are met:                                                                                        *
+*                                                                                                                      *
+*    * Redistributions of source code must retain the above copyright notice, this list of conditions, and the         *
+*      following disclaimer.                                                                                           *
+*                                                                                                                      *
+*    * Redistributions in binary form must reproduce the above copyright notice, this list of conditions and the       *
+*      following disclaimer in the documentation and/or other materials provided with the distribution.                *
+*                                                                                                                      *
+*    * Neither the name of the author nor the names of any contributors may be used to endorse or promote products     *
+*      derived from this software without specific prior written permission.                                           *
+*                                                                                                                      *
+* THIS SOFTWARE IS PROVIDED BY THE AUTHORS "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED   *
+* TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL *
+* THE AUTHORS BE HELD LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES        *
+* (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR       *
+* BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT *
+* (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE       *
+* POSSIBILITY OF SUCH DAMAGE.                                                                                          *
+*                                                                                                                      *
+***********************************************************************************************************************/
+
+/**
+	@file
+	@brief Fake hardware timer, so the timer-based classes can be tested on the host without SIMULATION
+ */
+
+#ifndef APB_Timer_h
+#define APB_Timer_h
+
+#include <stdint.h>
+
+#define HAVE_TIM
+
+/**
+	@brief Counter of any width up to 32 bits, set directly by the test
+
+	m_onRead, if set, is called after the count has been sampled but before it's returned, so a test can run code at
+	the point where an interrupt would preempt the reader.
+ */
+class Timer
+{
+public:
+	Timer(uint32_t bits = 32)
+	: m_count(0)
+	, m_mask( (bits >= 32) ? 0xffffffff : ( (1u << bits) - 1) )
+	, m_onRead(nullptr)
+	{}
+
+	uint32_t GetCount()
+	{
+		uint32_t count = m_count & m_mask;
+		if(m_onRead)
+			m_onRead();
+		return count;
+	}
+
+	///@brief True number of ticks since the timer started, not truncated to the counter width
+	uint64_t m_count;
+
+	uint32_t m_mask;
+
+	void (*m_onRead)();
+};
+
+#endif
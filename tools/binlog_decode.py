@@ -0,0 +1,213 @@
+#!/usr/bin/env python3
+"""
+Decoder for embedded-utils BinaryLogger streams.
+
+Reads the format strings out of the .logstr section of the firmware ELF, then turns a raw binary log capture (from a
+UART, debugger memory dump, etc) back into text.
+
+Usage: binlog_decode.py firmware.elf capture.bin [--tick-us 100]
+
+Timestamps are 64-bit MonotonicClock ticks, so --tick-us is the period of the logger's timer.
+"""
+
+import argparse
+import re
+import struct
+import sys
+from decimal import Decimal, ROUND_HALF_EVEN
+
+RECORD_MAGIC = 0xb1
+DROPPED_ID = 0xffffffff
+LOG_TYPES = {0: "TRACE: ", 1: "DEBUG: ", 2: "", 3: "WARNING: ", 4: "ERROR: "}
+
+def read_section(elf_path, name):
+	"""Returns (address, data) for the named section of a little endian ELF file"""
+
+	with open(elf_path, "rb") as f:
+		elf = f.read()
+
+	if elf[0:4] != b"\x7fELF":
+		raise ValueError("not an ELF file")
+	is64 = elf[4] == 2
+
+	if is64:
+		shoff, = struct.unpack_from("<Q", elf, 0x28)
+		shentsize, shnum, shstrndx = struct.unpack_from("<HHH", elf, 0x3a)
+	else:
+		shoff, = struct.unpack_from("<I", elf, 0x20)
+		shentsize, shnum, shstrndx = struct.unpack_from("<HHH", elf, 0x2e)
+
+	def header(i):
+		base = shoff + i*shentsize
+		if is64:
+			sname, stype, sflags, saddr, soff, ssize = struct.unpack_from("<IIQQQQ", elf, base)
+		else:
+			sname, stype, sflags, saddr, soff, ssize = struct.unpack_from("<IIIIII", elf, base)
+		return sname, saddr, soff, ssize
+
+	_, _, stroff, _ = header(shstrndx)
+	for i in range(shnum):
+		sname, saddr, soff, ssize = header(i)
+		end = elf.index(b"\0", stroff + sname)
+		if elf[stroff + sname:end].decode() == name:
+			return saddr, elf[soff:soff + ssize]
+
+	raise ValueError("no %s section in %s" % (name, elf_path))
+
+class Args:
+	"""Pulls argument words out of a record"""
+
+	def __init__(self, words):
+		self.words = words
+		self.pos = 0
+
+	def word(self):
+		w = self.words[self.pos]
+		self.pos += 1
+		return w
+
+	def dword(self):
+		lo = self.word()
+		return lo | (self.word() << 32)
+
+	def string(self):
+		n = self.word()
+		nwords = (n + 3) // 4
+		raw = struct.pack("<%dI" % nwords, *self.words[self.pos:self.pos + nwords])
+		self.pos += nwords
+		return raw[:n].decode("utf-8", "replace")
+
+def signed(v, bits):
+	if v & (1 << (bits - 1)):
+		return v - (1 << bits)
+	return v
+
+def pad(s, width, padchar, prepad):
+	if len(s) >= width:
+		return s
+	if prepad:
+		return padchar*(width - len(s)) + s
+	return s + padchar*(width - len(s))
+
+# Same grammar as DoPrintf: flags, width, precision, h/l/u modifiers, conversion
+SPEC = re.compile(r"%(-?)(\d*\*?)(?:\.(\d*))?([hlu]*)(.?)", re.S)
+
+def format_message(fmt, args):
+	"""Formats a message the same way DoPrintf would"""
+
+	out = []
+	pos = 0
+	for m in SPEC.finditer(fmt):
+		out.append(fmt[pos:m.start()])
+		pos = m.end()
+
+		left, widthstr, prec, mods, conv = m.groups()
+		#Zero padding doesn't apply to left justified fields
+		padchar = "0" if widthstr.startswith("0") and not left else " "
+		prepad = not left
+		if widthstr.endswith("*"):
+			width = signed(args.word(), 32)
+			if width < 0:
+				prepad = False
+				width = -width
+		else:
+			width = int(widthstr) if widthstr else 0
+		nlong = mods.count("l")
+		unsigned = "u" in mods
+		prec = int(prec) if prec else (None if prec is None else 0)
+
+		#%u followed by something other than a conversion is shorthand for %ud
+		if conv not in "%udkcsxXfFeE" or conv == "":
+			if unsigned:
+				pos -= len(conv)
+				conv = "u"
+			else:
+				out.append("*")
+				continue
+
+		if conv == "%":
+			out.append("%")
+		elif conv in "ud":
+			v = args.dword() if nlong >= 2 else args.word()
+			if conv == "d":
+				v = signed(v, 64 if nlong >= 2 else 32)
+			out.append(pad(str(v), width, padchar, prepad))
+		elif conv in "xX":
+			v = args.dword() if nlong >= 2 else args.word()
+			s = "%x" % v if conv == "x" else "%X" % v
+			out.append(pad(s, width, padchar, prepad))
+		elif conv == "c":
+			out.append(chr(args.word() & 0xff))
+		elif conv == "s":
+			out.append(pad(args.string(), width, padchar, prepad))
+		elif conv == "k":
+			if nlong:
+				bits, raw, size = 32, args.dword(), 64
+			elif "h" in mods:
+				bits, raw, size = 8, args.word() & 0xffff, 16
+			else:
+				bits, raw, size = 16, args.word(), 32
+			if not unsigned:
+				raw = signed(raw, size)
+			value = Decimal(raw) / Decimal(1 << bits)
+			p = 3 if prec is None else prec
+			s = str(value.quantize(Decimal(1).scaleb(-p), rounding=ROUND_HALF_EVEN))
+			ilen = s.find(".") if "." in s else len(s)
+			out.append(pad(s, width + len(s) - ilen, padchar, prepad))
+		elif conv in "fFeE":
+			v, = struct.unpack("<d", struct.pack("<Q", args.dword()))
+			s = ("%." + str(6 if prec is None else prec) + conv) % v
+			out.append(pad(s, width, padchar, prepad))
+
+	out.append(fmt[pos:])
+	return "".join(out)
+
+def decode(strings_addr, strings, data, tick_us, outfile):
+	nwords = len(data) // 4
+	words = struct.unpack("<%dI" % nwords, data[:nwords*4])
+
+	i = 0
+	while i < nwords:
+		header = words[i]
+		length = header & 0xffff
+		if (header >> 24) != RECORD_MAGIC or length < 4 or i + length > nwords:
+			#Lost sync, skip a word and try again
+			i += 1
+			continue
+
+		logtype = (header >> 16) & 0xff
+		fmtid = words[i+1]
+		timestamp = int((words[i+2] | (words[i+3] << 32)) * tick_us)
+		args = Args(words[i+4:i+length])
+		i += length
+
+		if fmtid == DROPPED_ID:
+			text = "%d log records dropped\n" % args.word()
+		else:
+			off = fmtid - strings_addr
+			end = strings.find(b"\0", off)
+			if off < 0 or end < 0:
+				text = "<unknown format string 0x%08x>\n" % fmtid
+			else:
+				try:
+					text = format_message(strings[off:end].decode(), args)
+				except IndexError:
+					text = "<truncated record for format string 0x%08x>\n" % fmtid
+
+		ms = timestamp // 1000
+		outfile.write("[%8d.%03d] %s%s" % (ms // 1000, ms % 1000, LOG_TYPES.get(logtype, ""), text))
+
+def main():
+	parser = argparse.ArgumentParser(description="Decode a BinaryLogger capture")
+	parser.add_argument("elf", help="Firmware ELF containing the .logstr section")
+	parser.add_argument("capture", help="Raw binary log capture")
+	parser.add_argument("--tick-us", type=float, default=100, help="Logger timer tick period in microseconds")
+	args = parser.parse_args()
+
+	addr, strings = read_section(args.elf, ".logstr")
+	with open(args.capture, "rb") as f:
+		data = f.read()
+	decode(addr, strings, data, args.tick_us, sys.stdout)
+
+if __name__ == "__main__":
+	main()
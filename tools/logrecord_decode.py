@@ -0,0 +1,115 @@
+#!/usr/bin/env python3
+"""
+Decoder for embedded-utils Logger structured records (LOGGER_STRUCTURED).
+
+Splits a capture (from a UART, debugger memory dump, etc) into COBS frames at each zero byte, and turns each record
+back into a text line or a JSON object. Frames which don't decode, such as text logged before structured mode was
+turned on, are skipped and counted.
+
+Usage: logrecord_decode.py capture.bin [--json]
+"""
+
+import argparse
+import json
+import struct
+import sys
+
+RECORD_LOG_MESSAGE = 0x01
+
+TAG_TIMESTAMP = 0x01
+TAG_LEVEL = 0x02
+TAG_MODULE = 0x03
+TAG_INDENT = 0x04
+TAG_SITE = 0x05
+TAG_TEXT = 0x06
+
+LOG_TYPES = {0: "TRACE", 1: "DEBUG", 2: "NORMAL", 3: "WARNING", 4: "ERROR"}
+
+def cobs_decode(frame):
+	"""Returns the decoded frame, or None if it isn't valid COBS"""
+
+	out = bytearray()
+	i = 0
+	while i < len(frame):
+		code = frame[i]
+		if code == 0 or i + code > len(frame):
+			return None
+		out += frame[i+1:i+code]
+		i += code
+		if code != 0xff and i < len(frame):
+			out.append(0)
+	return bytes(out)
+
+def parse_record(data):
+	"""Returns a dict of the fields of a log message record, or None if it isn't one"""
+
+	if len(data) < 1 or data[0] != RECORD_LOG_MESSAGE:
+		return None
+
+	rec = {}
+	i = 1
+	while i < len(data):
+		if i + 2 > len(data):
+			return None
+		tag = data[i]
+		length = data[i+1]
+		value = data[i+2:i+2+length]
+		if len(value) != length:
+			return None
+		i += 2 + length
+
+		#Tags we don't know about are skipped
+		if tag == TAG_TIMESTAMP and length == 8:
+			rec["time_us"], = struct.unpack("<Q", value)
+		elif tag == TAG_LEVEL and length == 1:
+			rec["level"] = LOG_TYPES.get(value[0], str(value[0]))
+		elif tag == TAG_MODULE and length == 1:
+			rec["module"] = value[0]
+		elif tag == TAG_INDENT and length == 1:
+			rec["indent"] = value[0]
+		elif tag == TAG_SITE and length == 4:
+			rec["site"], = struct.unpack("<I", value)
+		elif tag == TAG_TEXT:
+			rec["text"] = value.decode("utf-8", "replace").replace("\r\n", "\n")
+
+	return rec
+
+def decode(data, as_json, outfile):
+	bad = 0
+	for frame in data.split(b"\0"):
+		if not frame:
+			continue
+
+		decoded = cobs_decode(frame)
+		rec = parse_record(decoded) if decoded is not None else None
+		if rec is None:
+			bad += 1
+			continue
+
+		if as_json:
+			outfile.write(json.dumps(rec) + "\n")
+		else:
+			us = rec.get("time_us", 0)
+			level = rec.get("level", "NORMAL")
+			prefix = "" if level == "NORMAL" else level + ": "
+			outfile.write("[%8d.%06d] %s%s%s\n" % (
+				us // 1000000, us % 1000000, "    " * rec.get("indent", 0), prefix, rec.get("text", "")))
+
+	if bad:
+		sys.stderr.write("%d frames skipped\n" % bad)
+
+def main():
+	parser = argparse.ArgumentParser(description="Decode a Logger structured record capture")
+	parser.add_argument("capture", help="Raw capture, or - for stdin")
+	parser.add_argument("--json", action="store_true", help="Print one JSON object per record")
+	args = parser.parse_args()
+
+	if args.capture == "-":
+		data = sys.stdin.buffer.read()
+	else:
+		with open(args.capture, "rb") as f:
+			data = f.read()
+	decode(data, args.json, sys.stdout)
+
+if __name__ == "__main__":
+	main()
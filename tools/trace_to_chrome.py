@@ -0,0 +1,84 @@
+#!/usr/bin/env python3
+"""
+Converts an embedded-utils Tracer dump to Chrome trace JSON, for chrome://tracing or ui.perfetto.dev.
+
+Reads the event names out of the .logstr section of the firmware ELF, then turns the output of Tracer::Dump() (from a
+UART, debugger memory dump, etc) into trace events.
+
+Usage: trace_to_chrome.py firmware.elf dump.bin > trace.json
+"""
+
+import argparse
+import json
+import struct
+import sys
+
+from binlog_decode import read_section
+
+TRACE_MAGIC = 0x31435254
+ID_MASK = 0x3fffffff
+PHASES = {1: "B", 2: "E", 3: "i"}
+
+def convert(strings_addr, strings, data):
+	"""Returns a Chrome trace object for a dump"""
+
+	magic, rate, count, overwritten = struct.unpack_from("<4I", data, 0)
+	if magic != TRACE_MAGIC:
+		raise ValueError("not a Tracer dump")
+	count = min(count, (len(data) - 16) // 12)
+
+	events = []
+	if overwritten:
+		sys.stderr.write("%d older events were overwritten\n" % overwritten)
+
+	#Timestamps are the low 32 bits of the tracer's 64-bit clock, so unwrap them assuming less than a 32-bit wrap
+	#between consecutive events
+	now = 0
+	last = None
+	depth = 0
+	for i in range(count):
+		timestamp, ident, arg = struct.unpack_from("<3I", data, 16 + i*12)
+		if last is not None:
+			now += (timestamp - last) & 0xffffffff
+		last = timestamp
+
+		phase = PHASES.get(ident >> 30)
+		if phase is None:
+			continue
+
+		#The beginning of spans still open when the ring wrapped is gone, so drop their ends too
+		if phase == "B":
+			depth += 1
+		elif phase == "E":
+			if depth == 0:
+				continue
+			depth -= 1
+
+		off = ((ident & ID_MASK) - strings_addr) & ID_MASK
+		end = strings.find(b"\0", off)
+		if end < 0:
+			name = "0x%08x" % (ident & ID_MASK)
+		else:
+			name = strings[off:end].decode("utf-8", "replace")
+
+		ev = {"name": name, "ph": phase, "ts": now * 1e6 / rate, "pid": 0, "tid": 0, "args": {"arg": arg}}
+		if phase == "i":
+			ev["s"] = "t"
+		events.append(ev)
+
+	return {"traceEvents": events, "displayTimeUnit": "ns"}
+
+def main():
+	parser = argparse.ArgumentParser(description="Convert a Tracer dump to Chrome trace JSON")
+	parser.add_argument("elf", help="Firmware ELF containing the .logstr section")
+	parser.add_argument("dump", help="Output of Tracer::Dump()")
+	args = parser.parse_args()
+
+	addr, strings = read_section(args.elf, ".logstr")
+	with open(args.dump, "rb") as f:
+		data = f.read()
+	json.dump(convert(addr & ID_MASK, strings, data), sys.stdout)
+	sys.stdout.write("\n")
+
+if __name__ == "__main__":
+	main()